@@ -48,9 +48,16 @@
 
 
 static uint8_t frame_buffer[FRAME_BUFFER_SIZE] = {0};
+static uint8_t display_ram[FRAME_BUFFER_SIZE] = {0};     // Copy of display GRAM. Also used as PDC source for row transfer
+static uint32_t invalid_rows = 0xFF;                      // Rows with unknown display GRAM content (bit per row)
+
+static uint8_t row_address_cmd[3] = {0};
+static i2c_transaction_t row_address_transaction = {0};
+static i2c_transaction_t row_data_transaction = {0};
     
 static bool ssd1306_send_command(uint8_t cmd, uint8_t data, bool is_data);
 static bool ssd1306_send_bytes(uint8_t* data, uint32_t bytes_count);
+static bool ssd1306_set_address(uint32_t row, uint32_t column);
 
 
 //  ***************************************************************************
@@ -80,9 +87,10 @@ bool ssd1306_128x64_init(void) {
     // Timing and driving scheme configuration
     if (!ssd1306_send_command(SET_DISPLAY_CLOCK_DIV, 0x80, true)) return false;                // Select display clock divide ratio/oscillator frequency register
     
-    // Clear buffers
+    // Clear buffers. Display RAM is updated by first frame transfer
     memset(frame_buffer, 0x00, sizeof(frame_buffer));
-    return ssd1306_128x64_full_update();
+    invalid_rows = 0xFF;
+    return true;
 }
 
 //  ***************************************************************************
@@ -127,17 +135,56 @@ bool ssd1306_128x64_set_state(bool is_enable) {
 
 //  ***************************************************************************
 /// @brief    Start asynchronous update row
+/// @note     Only changed columns span of row is transferred. If row is not
+///           changed, then transfer is not started and function returns true
 /// @param    row: row index [0; 7]
 /// @return    true - success, false - error
 //  ***************************************************************************
 bool ssd1306_128x64_start_async_update_row(uint32_t row) {
     
-    if (!ssd1306_send_command(SET_PAGE_START + row, 0x00, false)) return false;
-    if (!ssd1306_send_command(SET_LOW_COLUMN, 0x00, false)) return false;
-    if (!ssd1306_send_command(SET_HIGH_COLUMN, 0x00, false)) return false;
+    uint8_t* src = &frame_buffer[row * FRAME_COLUMN_COUNT];
+    uint8_t* dst = &display_ram[row * FRAME_COLUMN_COUNT];
+    
+    // Search changed columns span
+    int32_t begin = 0;
+    int32_t end = FRAME_COLUMN_COUNT - 1;
+    if ((invalid_rows & (1 << row)) == 0) {
+        
+        while (begin < FRAME_COLUMN_COUNT && src[begin] == dst[begin]) {
+            ++begin;
+        }
+        if (begin == FRAME_COLUMN_COUNT) {
+            return true; // Row is not changed
+        }
+        while (src[end] == dst[end]) {
+            --end;
+        }
+    }
+    
+    // Take span snapshot. Frame buffer can be changed while transfer in progress
+    uint32_t bytes_count = end - begin + 1;
+    memcpy(&dst[begin], &src[begin], bytes_count);
+    invalid_rows &= ~(1 << row);
+    
+    // Queue address and data transactions. Other devices transactions can be executed between them
+    row_address_cmd[0] = SET_PAGE_START + row;
+    row_address_cmd[1] = SET_LOW_COLUMN | (begin & 0x0F);
+    row_address_cmd[2] = SET_HIGH_COLUMN | (begin >> 4);
+    
+    row_address_transaction.dev_addr = DISPLAY_I2C_ADDRESS;
+    row_address_transaction.internal_addr = 0x00; // 0x00 - Control byte = Command
+    row_address_transaction.internal_addr_length = 1;
+    row_address_transaction.buffer = row_address_cmd;
+    row_address_transaction.bytes_count = sizeof(row_address_cmd);
     
-    uint8_t* row_buffer = &frame_buffer[row * FRAME_COLUMN_COUNT];
-    return i2c_async_write_bytes(DISPLAY_I2C_ADDRESS, 0x40, 1, row_buffer, FRAME_COLUMN_COUNT);
+    row_data_transaction.dev_addr = DISPLAY_I2C_ADDRESS;
+    row_data_transaction.internal_addr = 0x40; // 0x40 - Control byte = Data
+    row_data_transaction.internal_addr_length = 1;
+    row_data_transaction.buffer = &dst[begin];
+    row_data_transaction.bytes_count = bytes_count;
+    
+    if (!i2c_submit_transaction(&row_address_transaction, I2C_PRIORITY_LOW)) return false;
+    return i2c_submit_transaction(&row_data_transaction, I2C_PRIORITY_LOW);
 }
 
 //  ***************************************************************************
@@ -147,7 +194,7 @@ bool ssd1306_128x64_start_async_update_row(uint32_t row) {
 //  ***************************************************************************
 bool ssd1306_128x64_is_async_operation_complete(void) {
     
-    return i2c_is_async_operation_complete();
+    return i2c_is_transaction_complete(&row_address_transaction) && i2c_is_transaction_complete(&row_data_transaction);
 }
 
 //  ***************************************************************************
@@ -157,7 +204,7 @@ bool ssd1306_128x64_is_async_operation_complete(void) {
 //  ***************************************************************************
 bool ssd1306_128x64_is_async_operation_success(void) {
     
-    return i2c_get_async_operation_status();
+    return row_address_transaction.status != I2C_TRANSACTION_FAIL && row_data_transaction.status != I2C_TRANSACTION_FAIL;
 }
 
 //  ***************************************************************************
@@ -167,15 +214,16 @@ bool ssd1306_128x64_is_async_operation_success(void) {
 //  ***************************************************************************
 bool ssd1306_128x64_full_update(void) {
     
+    memcpy(display_ram, frame_buffer, sizeof(display_ram));
+    invalid_rows = 0xFF;
+    
     for (uint32_t i = 0; i < FRAME_ROW_COUNT; ++i) {
 
-        if (!ssd1306_send_command(SET_PAGE_START + i, 0x00, false)) return false;
-        if (!ssd1306_send_command(SET_LOW_COLUMN, 0x00, false)) return false;
-        if (!ssd1306_send_command(SET_HIGH_COLUMN, 0x00, false)) return false;
-        
-        if (!ssd1306_send_bytes(&frame_buffer[FRAME_COLUMN_COUNT * i], FRAME_COLUMN_COUNT)) return false;
+        if (!ssd1306_set_address(i, 0)) return false;
+        if (!ssd1306_send_bytes(&display_ram[FRAME_COLUMN_COUNT * i], FRAME_COLUMN_COUNT)) return false;
     }
     
+    invalid_rows = 0x00;
     return true;
 }
 
@@ -222,4 +270,22 @@ static bool ssd1306_send_bytes(uint8_t* data, uint32_t bytes_count) {
     
     // 0x40 - Control byte = Data
     return i2c_write_bytes(DISPLAY_I2C_ADDRESS, 0x40, 1, data, bytes_count);
+}
+
+//  ***************************************************************************
+/// @brief    Set display GRAM address
+/// @note     Page and column are sent by one transaction
+/// @param    row: row index [0; 7]
+/// @param    column: GRAM column index (include dead zone)
+/// @return    true - success, false - error
+//  ***************************************************************************
+static bool ssd1306_set_address(uint32_t row, uint32_t column) {
+    
+    uint8_t* tx_buffer = i2c_get_internal_tx_buffer_address();
+    tx_buffer[0] = SET_PAGE_START + row;
+    tx_buffer[1] = SET_LOW_COLUMN | (column & 0x0F);
+    tx_buffer[2] = SET_HIGH_COLUMN | (column >> 4);
+    
+    // 0x00 - Control byte = Command
+    return i2c_write_bytes(DISPLAY_I2C_ADDRESS, 0x00, 1, NULL, 3);
 }
\ No newline at end of file
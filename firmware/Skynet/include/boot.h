@@ -0,0 +1,31 @@
+//  ***************************************************************************
+/// @file    boot.h
+/// @author  NeoProg
+/// @brief   Boot timeline
+//  ***************************************************************************
+#ifndef BOOT_H_
+#define BOOT_H_
+
+#include <stdint.h>
+
+
+typedef enum {
+    BOOT_STAGE_PERIPHERY,               // System timer, LED, I2C
+    BOOT_STAGE_GUI,                     // Display configured, logo transfer started
+    BOOT_STAGE_MEMORY,                  // VEEPROM loaded and checked, configuration decoded
+    BOOT_STAGE_COMMUNICATION,           // Transport and protocols
+    BOOT_STAGE_SENSORS,                 // Monitoring and orientation
+    BOOT_STAGE_SERVO,                   // Servo driver, limbs driver, movement engine
+    BOOT_STAGE_READY,                   // First main loop pass complete, requests are accepted
+    BOOT_STAGE_DISPLAY,                 // Logo shown and main screen drawn
+    BOOT_STAGE_COUNT
+} boot_stage_t;
+
+
+extern uint32_t boot_timeline[BOOT_STAGE_COUNT];
+
+
+extern void boot_mark_stage(boot_stage_t stage);
+
+
+#endif /* BOOT_H_ */
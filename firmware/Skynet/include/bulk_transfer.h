@@ -0,0 +1,22 @@
+//  ***************************************************************************
+/// @file    bulk_transfer.h
+/// @author  NeoProg
+/// @brief   Bulk transfer of large memory blobs by chunks
+//  ***************************************************************************
+#ifndef BULK_TRANSFER_H_
+#define BULK_TRANSFER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BULK_TRANSFER_BLOB_FIRMWARE         (0x00)      // Internal flash bank 0
+#define BULK_TRANSFER_BLOB_VEEPROM          (0x01)      // VEEPROM flash pages
+#define BULK_TRANSFER_BLOB_RAM_MAP          (0x02)      // RAM map address space
+#define BULK_TRANSFER_BLOB_COUNT            (3)
+
+
+extern bool bulk_transfer_get_blob_size(uint32_t blob_id, uint32_t* size);
+extern bool bulk_transfer_read(uint32_t blob_id, uint32_t offset, uint8_t* buffer, uint32_t size);
+
+
+#endif /* BULK_TRANSFER_H_ */
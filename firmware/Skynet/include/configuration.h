@@ -0,0 +1,77 @@
+//  ***************************************************************************
+/// @file    configuration.h
+/// @author  NeoProg
+/// @brief   Configuration image. Image is read from VEEPROM by one block and
+///          decoded on boot. Layout matches veeprom_map.h
+//  ***************************************************************************
+#ifndef CONFIGURATION_H_
+#define CONFIGURATION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CONFIGURATION_VERSION                   (0x0001)
+
+#define CONFIGURATION_LIMB_SLOT_COUNT           (8)
+#define CONFIGURATION_SERVO_SLOT_COUNT          (20)
+#define CONFIGURATION_VOLTAGE_DIVISOR_SLOT_COUNT (10)
+#define CONFIGURATION_CALIBRATION_TABLE_SIZE    (28)
+
+
+typedef struct __attribute__((packed)) {
+    
+    uint16_t link_length[3];                    // Coxa, femur, tibia
+    int16_t  link_zero_rotate[3];
+    uint8_t  reserved0[4];
+    int8_t   link_angle_range[3][2];            // Min, max
+    int16_t  start_position[3];                 // X, Y, Z
+    uint8_t  reserved1[4];
+    
+} limb_configuration_t;
+
+typedef struct __attribute__((packed)) {
+    
+    uint8_t  config;                            // SERVO_CONFIG_xxx_MASK flags
+    uint8_t  angle_correction;
+    uint8_t  reserved0[2];
+    uint16_t max_physic_angle;
+    uint8_t  reserved1[2];
+    uint16_t calibration_table[CONFIGURATION_CALIBRATION_TABLE_SIZE];
+    
+} servo_configuration_t;
+
+typedef struct __attribute__((packed)) {
+    
+    uint32_t up_resist;
+    uint32_t down_resist;
+    
+} voltage_divisor_configuration_t;
+
+typedef struct __attribute__((packed)) {
+    
+    limb_configuration_t            limbs[CONFIGURATION_LIMB_SLOT_COUNT];
+    servo_configuration_t           servos[CONFIGURATION_SERVO_SLOT_COUNT];
+    voltage_divisor_configuration_t voltage_divisors[CONFIGURATION_VOLTAGE_DIVISOR_SLOT_COUNT];
+    uint8_t  battery_low_voltage_threshold;
+    uint8_t  reserved0[15];
+    uint32_t front_distance_low_limit;
+    uint8_t  reserved1[140];
+    
+    // Image header. Not written header (0xFF) - image of previous tools, image is not checked
+    uint16_t version;
+    uint16_t size;                              // Size of data before header
+    uint32_t crc;                               // CRC32 of data before header
+    uint8_t  reserved2[8];
+    
+} configuration_t;
+
+
+extern bool configuration_init(void);
+extern bool configuration_update_header(void);
+extern const configuration_t* configuration_get(void);
+extern const limb_configuration_t* configuration_get_limb(uint32_t index);
+extern const servo_configuration_t* configuration_get_servo(uint32_t index);
+extern const voltage_divisor_configuration_t* configuration_get_voltage_divisor(uint32_t index);
+
+
+#endif /* CONFIGURATION_H_ */
@@ -0,0 +1,27 @@
+//  ***************************************************************************
+/// @file    crc16.h
+/// @author  NeoProg
+/// @brief   ModBus CRC16 calculation (table-driven)
+/// @note    Shared between firmware and host software
+//  ***************************************************************************
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRC16_INITIAL_VALUE                     (0xFFFF)
+
+
+extern uint16_t crc16_update(uint16_t crc, const uint8_t* data, uint32_t size);
+extern uint16_t crc16_calculate(const uint8_t* data, uint32_t size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC16_H_ */
@@ -0,0 +1,18 @@
+//  ***************************************************************************
+/// @file    crc32.h
+/// @author  NeoProg
+/// @brief   CRC32 calculation (table-driven, IEEE 802.3)
+//  ***************************************************************************
+#ifndef CRC32_H_
+#define CRC32_H_
+
+#include <stdint.h>
+
+#define CRC32_INITIAL_VALUE                     (0xFFFFFFFF)
+
+
+extern uint32_t crc32_update(uint32_t crc, const uint8_t* data, uint32_t size);
+extern uint32_t crc32_calculate(const uint8_t* data, uint32_t size);
+
+
+#endif /* CRC32_H_ */
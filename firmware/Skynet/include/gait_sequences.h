@@ -30,6 +30,17 @@ typedef struct {
     
 } sequence_info_t;
 
+#define SEQUENCE_PRECONDITION_NONE              (0x00)
+#define SEQUENCE_PRECONDITION_HEXAPOD_DOWN      (0x01)  // Hexapod should be in DOWN state
+#define SEQUENCE_PRECONDITION_HEXAPOD_UP        (0x02)  // Hexapod should be in UP state
+#define SEQUENCE_PRECONDITION_FRONT_DISTANCE    (0x04)  // Front distance should be greater low limit
+
+typedef struct {
+    uint8_t scr_cmd;                    // SCR command code for select sequence (0x00 - not available from SCR)
+    uint8_t preconditions;              // SEQUENCE_PRECONDITION_xxx flags
+    const sequence_info_t* info;        // Sequence data
+} sequence_descriptor_t;
+
 
 static sequence_info_t sequence_down = {  
     
@@ -672,4 +683,32 @@ static sequence_info_t sequence_rotate_z = {
 };
 
 
+//
+// Sequence registry. Each entry binds SCR command code, preconditions and sequence data together.
+// For add new sequence need add sequence ID into sequence_id_t and describe it here
+//
+static const sequence_descriptor_t sequence_registry[SUPPORT_SEQUENCE_COUNT] = {
+
+    [SEQUENCE_NONE]                  = { .scr_cmd = 0x90, .preconditions = SEQUENCE_PRECONDITION_NONE,                                                 .info = NULL },
+    [SEQUENCE_UPDATE_HEIGHT]         = { .scr_cmd = 0x00, .preconditions = SEQUENCE_PRECONDITION_NONE,                                                 .info = NULL },
+    [SEQUENCE_UP]                    = { .scr_cmd = 0x01, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_DOWN,                                         .info = &sequence_up },
+    [SEQUENCE_DOWN]                  = { .scr_cmd = 0x02, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_down },
+    [SEQUENCE_RUN]                   = { .scr_cmd = 0x03, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_run },
+    [SEQUENCE_DIRECT_MOVEMENT]       = { .scr_cmd = 0x04, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP | SEQUENCE_PRECONDITION_FRONT_DISTANCE,    .info = &sequence_direct_movement },
+    [SEQUENCE_REVERSE_MOVEMENT]      = { .scr_cmd = 0x05, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_reverse_movement },
+    [SEQUENCE_ROTATE_LEFT]           = { .scr_cmd = 0x06, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_rotate_left },
+    [SEQUENCE_ROTATE_RIGHT]          = { .scr_cmd = 0x07, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_rotate_right },
+    [SEQUENCE_DIRECT_MOVEMENT_SLOW]  = { .scr_cmd = 0x08, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP | SEQUENCE_PRECONDITION_FRONT_DISTANCE,    .info = &sequence_direct_movement_slow },
+    [SEQUENCE_REVERSE_MOVEMENT_SLOW] = { .scr_cmd = 0x09, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_reverse_movement_slow },
+    [SEQUENCE_SHIFT_LEFT]            = { .scr_cmd = 0x10, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_shift_left },
+    [SEQUENCE_SHIFT_RIGHT]           = { .scr_cmd = 0x11, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_shift_right },
+    [SEQUENCE_ATTACK_LEFT]           = { .scr_cmd = 0x20, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_attack_left },
+    [SEQUENCE_ATTACK_RIGHT]          = { .scr_cmd = 0x21, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_attack_right },
+    [SEQUENCE_DANCE]                 = { .scr_cmd = 0x30, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_dance },
+    [SEQUENCE_ROTATE_X]              = { .scr_cmd = 0x31, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_rotate_x },
+  //[SEQUENCE_ROTATE_Y]              = { .scr_cmd = 0x32, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_rotate_y },
+    [SEQUENCE_ROTATE_Z]              = { .scr_cmd = 0x33, .preconditions = SEQUENCE_PRECONDITION_HEXAPOD_UP,                                           .info = &sequence_rotate_z },
+};
+
+
 #endif /* GAIT_SEQUENCES_H_ */
\ No newline at end of file
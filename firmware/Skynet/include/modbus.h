@@ -6,9 +6,29 @@
 #ifndef MODBUS_H_
 #define MODBUS_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "transport.h"
+
+#define TELEMETRY_PORT_DISABLED                 (0x00)
+#define TELEMETRY_PORT_USART0                   (0x01)
+#define TELEMETRY_PORT_USART3                   (0x02)
+#define TELEMETRY_MAX_RANGE_COUNT               (16)
+
+
+// Telemetry subscription registers. Period and range list are applied by write to port register
+extern uint8_t  telemetry_port;
+extern uint16_t telemetry_period;
+extern uint8_t  telemetry_range_count;
+extern uint8_t  telemetry_range_list[];
+
 
 extern void modbus_init(void);
 extern void modbus_process(void);
+extern bool modbus_apply_telemetry_subscription(void);
+extern bool modbus_is_frame_detected(const uint8_t* request, uint32_t size, uint16_t crc);
+extern transport_priority_t modbus_get_frame_priority(const uint8_t* request, uint32_t size);
+extern transport_result_t modbus_process_frame(uint32_t port, const uint8_t* request, uint32_t request_size);
 
 
 #endif /* MODBUS_H_ */
\ No newline at end of file
@@ -7,6 +7,7 @@
 #define MOVEMENT_ENGINE_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 
 
 typedef enum {
@@ -44,6 +45,7 @@ extern void movement_engine_process(void);
 extern void movement_engine_increase_height(void);
 extern void movement_engine_decrease_height(void);
 extern void movement_engine_select_sequence(sequence_id_t sequence);
+extern bool movement_engine_select_sequence_by_scr_cmd(uint8_t scr_cmd);
 
 
 #endif /* MOVEMENT_ENGINE_H_ */
\ No newline at end of file
@@ -16,9 +16,11 @@ extern void oled_gl_clear_display(void);
 extern void oled_gl_clear_row_fragment(uint32_t row, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
 
 extern void oled_gl_draw_float_number(uint32_t row, uint32_t x, float number);
+extern void oled_gl_draw_fixed_number(uint32_t row, uint32_t x, int32_t number, uint32_t fraction_digits, uint32_t width);
 extern void oled_gl_draw_dec_number(uint32_t row, uint32_t x, int32_t number);
 extern void oled_gl_draw_hex_number(uint32_t row, uint32_t x, uint32_t number);
 extern void oled_gl_draw_string(uint32_t row, uint32_t x, const char* str);
+extern void oled_gl_draw_string_xy(uint32_t x, uint32_t y, const char* str);
 
 extern void oled_gl_draw_horizontal_line(uint32_t row, uint32_t x, uint32_t y, uint32_t width);
 extern void oled_gl_draw_rect(uint32_t row, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
@@ -28,6 +30,7 @@ extern void oled_gl_draw_bitmap(uint32_t row, uint32_t x, uint32_t bitmap_width,
 extern void oled_gl_display_update(void);
 extern void oled_gl_start_async_display_update(void);
 extern void oled_gl_async_display_update_process(void);
+extern bool oled_gl_is_async_display_update_complete(void);
 
 
 #endif /* OLED_GL_H_ */
\ No newline at end of file
@@ -12,10 +12,13 @@
 #define RAM_MAP_SIZE                    (512)
 #define RAM_MAP_BEGIN_ADDRESS           (0x0000)
 #define RAM_MAP_END_ADDRESS             (RAM_MAP_BEGIN_ADDRESS + RAM_MAP_SIZE)
+#define RAM_MAP_RANGE_DESCRIPTOR_SIZE   (3)         // [address high][address low][bytes count]
 
 
 extern bool ram_map_read(uint32_t ram_address, uint8_t* buffer, uint32_t bytes_count);
 extern bool ram_map_write(uint32_t ram_address, const uint8_t* buffer, uint32_t bytes_count);
+extern bool ram_map_read_multiple(const uint8_t* range_list, uint32_t range_count, uint8_t* buffer, uint32_t buffer_size, uint32_t* bytes_count);
+extern void ram_map_process(void);
 
 
 #endif /* RAM_MAP_H_ */
\ No newline at end of file
@@ -7,12 +7,16 @@
 #define SCR_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 
 
 extern uint8_t scr;
 extern int32_t scr_argument;
+extern uint8_t scr_last_queued_id;
+extern uint8_t scr_last_completed_id;
 
 
+extern bool scr_push_command(void);
 extern void scr_process(void);
 
 
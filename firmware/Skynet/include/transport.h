@@ -0,0 +1,46 @@
+//  ***************************************************************************
+/// @file    transport.h
+/// @author  NeoProg
+/// @brief   USART transport. Dispatch received frames to protocol handlers
+//  ***************************************************************************
+#ifndef TRANSPORT_H_
+#define TRANSPORT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRANSPORT_PORT_USART0                   (0)
+#define TRANSPORT_PORT_USART3                   (1)
+#define TRANSPORT_PORT_COUNT                    (2)
+
+#define TRANSPORT_DEFAULT_BAUD_RATE             (115200)
+
+
+typedef enum {
+    TRANSPORT_PRIORITY_CONTROL,                 // RAM and SCR writes
+    TRANSPORT_PRIORITY_READ,                    // RAM reads
+    TRANSPORT_PRIORITY_BULK,                    // EEPROM and bulk transfers. One frame per process call
+    TRANSPORT_PRIORITY_COUNT
+} transport_priority_t;
+
+typedef enum {
+    TRANSPORT_FRAME_PROCESSED,                  // Frame buffer can be released
+    TRANSPORT_FRAME_WAIT                        // Frame stays in RX buffer until next process call
+} transport_result_t;
+
+
+extern void transport_init(void);
+extern void transport_process(void);
+
+extern bool     transport_is_frame_received(uint32_t port);
+extern bool     transport_is_tx_buffer_free(uint32_t port);
+extern bool     transport_is_tx_complete(uint32_t port);
+extern uint8_t* transport_get_tx_buffer(uint32_t port);
+extern void     transport_start_tx(uint32_t port, uint32_t bytes_count);
+extern uint8_t* transport_get_rx_buffer_for_tx(uint32_t port);
+extern void     transport_start_tx_from_rx_buffer(uint32_t port, uint32_t bytes_count);
+extern bool     transport_is_baud_rate_switch_allowed(uint32_t port);
+extern void     transport_set_baud_rate(uint32_t port, uint32_t baud_rate);
+
+
+#endif /* TRANSPORT_H_ */
@@ -8,15 +8,29 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "flash.h"
+
+#define VEEPROM_PAGE_SIZE               (FLASH_PAGE_SIZE)
+#define VEEPROM_PAGE_COUNT              (10)
+#define VEEPROM_SIZE                    (VEEPROM_PAGE_SIZE * VEEPROM_PAGE_COUNT)    // bytes
+
+
+extern uint32_t veeprom_crc;
+extern uint16_t veeprom_bad_pages;
 
 
 extern void veeprom_init(void);
-extern bool veeprom_update_checksum(void);
+extern void veeprom_process(void);
+extern bool veeprom_commit(void);
+extern void veeprom_flush(void);
+extern bool veeprom_is_dirty(void);
+extern bool veeprom_is_busy(void);
+extern void veeprom_update_checksum(void);
 
 extern uint8_t  veeprom_read_8(uint32_t veeprom_address);
 extern uint16_t veeprom_read_16(uint32_t veeprom_address);
 extern uint32_t veeprom_read_32(uint32_t veeprom_address);
-extern void     veeprom_read_bytes(uint32_t veeprom_address, uint8_t* data, uint32_t size);
+extern bool     veeprom_read_bytes(uint32_t veeprom_address, uint8_t* data, uint32_t size);
 
 extern bool veeprom_write_8(uint32_t veeprom_address, uint8_t data);
 extern bool veeprom_write_16(uint32_t veeprom_address, uint16_t data);
@@ -7,20 +7,44 @@
 #define WIRELESS_MODBUS_H_
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "transport.h"
 
 
 #define WIRELESS_MODBUS_FRAME_SIZE						(sizeof(wireless_frame_t))
 #define WIRELESS_MODBUS_FRAME_DATA_SIZE					(1017)
 #define WIRELESS_MODBUS_FRAME_CRC_SIZE					(2)
+#define WIRELESS_MODBUS_FRAME_HEADER_SIZE				(5)		// Function code, address, bytes count
 
 #define WIRELESS_MODBUS_CMD_WRITE_RAM					(0x41)	// Function Code: Write RAM
 #define WIRELESS_MODBUS_CMD_READ_RAM					(0x44)	// Function Code: Read RAM
-#define WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA_SIZE	(0x60)	// Function Code: Read multimedia data size
-#define WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA		(0x61)	// Function Code: Read multimedia data
+#define WIRELESS_MODBUS_CMD_READ_RAM_MULTIPLE			(0x47)	// Function Code: Read several RAM ranges
+#define WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA_SIZE	(0x60)	// Function Code: Read bulk transfer blob info
+#define WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA		(0x61)	// Function Code: Read bulk transfer blob chunk
 #define WIRELESS_MODBUS_EXCEPTION						(0x80)	// Function Code: Exception
 
+// Variable size frame: header, data of used size only, CRC
+#define WIRELESS_MODBUS_VARIABLE_FRAME					(0x10)	// Function Code flag: variable size frame
+#define WIRELESS_MODBUS_CMD_WRITE_RAM_VARIABLE			(WIRELESS_MODBUS_CMD_WRITE_RAM         | WIRELESS_MODBUS_VARIABLE_FRAME)
+#define WIRELESS_MODBUS_CMD_READ_RAM_VARIABLE			(WIRELESS_MODBUS_CMD_READ_RAM          | WIRELESS_MODBUS_VARIABLE_FRAME)
+#define WIRELESS_MODBUS_CMD_READ_RAM_MULTIPLE_VARIABLE	(WIRELESS_MODBUS_CMD_READ_RAM_MULTIPLE | WIRELESS_MODBUS_VARIABLE_FRAME)
+#define WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA_SIZE_VARIABLE	(WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA_SIZE | WIRELESS_MODBUS_VARIABLE_FRAME)
+#define WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA_VARIABLE		(WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA      | WIRELESS_MODBUS_VARIABLE_FRAME)
 
-// Frame size - 1024 bytes
+// Bulk transfer. Blob info request: address - blob ID.
+// Blob info response: bytes_count - 7, data - [blob size:4][max chunk size:2][window size:1].
+// Chunk request: address - blob ID, bytes_count - chunk size, data - [offset:4].
+// Chunk response: bytes_count - actual chunk size, data - [offset:4][chunk][chunk CRC16:2].
+// Up to window size chunk requests may be sent without waiting for responses
+#define WIRELESS_MODBUS_BULK_INFO_SIZE					(7)
+#define WIRELESS_MODBUS_BULK_OFFSET_SIZE				(4)
+#define WIRELESS_MODBUS_BULK_CHUNK_CRC_SIZE				(2)
+#define WIRELESS_MODBUS_BULK_MAX_CHUNK_SIZE				(WIRELESS_MODBUS_FRAME_DATA_SIZE - WIRELESS_MODBUS_BULK_OFFSET_SIZE - WIRELESS_MODBUS_BULK_CHUNK_CRC_SIZE)
+
+
+// Frame size - 1024 bytes. Variable size frame contains data[bytes_count] for write RAM,
+// data[bytes_count * 3] for read several RAM ranges, data[4] for read bulk transfer chunk
+// and no data for other requests
 typedef struct __attribute__ ((packed)) {
 
 	uint8_t  function_code;
@@ -32,8 +56,9 @@ typedef struct __attribute__ ((packed)) {
 } wireless_frame_t;
 
 
-extern void wireless_modbus_init(void);
-extern void wireless_modbus_process(void);
+extern bool wireless_modbus_is_frame_detected(const uint8_t* raw_frame, uint32_t frame_size, uint16_t crc);
+extern transport_priority_t wireless_modbus_get_frame_priority(const uint8_t* raw_frame, uint32_t frame_size);
+extern transport_result_t wireless_modbus_process_frame(uint32_t port, const uint8_t* frame_data, uint32_t frame_size);
 
 
 #endif /* WIRELESS_MODBUS_H_ */
\ No newline at end of file
@@ -9,8 +9,14 @@
 
 
 uint8_t flash_ram_buffer[FLASH_PAGE_SIZE] = {0};
+static uint32_t write_page_start_address = 0;
+static flash_write_status_t write_status = FLASH_WRITE_SUCCESS;
 
 
+__attribute__((__noinline__))
+__attribute__((section(".ramfunc")))
+static void flash_start_cmd(uint32_t cmd, uint16_t arg);
+
 __attribute__((__noinline__))
 __attribute__((section(".ramfunc")))
 static bool flash_execute_cmd(uint32_t cmd, uint16_t arg);
@@ -82,6 +88,8 @@ void flash_read_bytes(uint32_t flash_address, uint8_t* buffer, uint32_t size) {
         return;
     }
     
+    // Bank can not be read while page is programmed
+    while (flash_get_write_status() == FLASH_WRITE_IN_PROGRESS);
     
     uint8_t* memory = (uint8_t*)flash_address;
     for (uint32_t i = 0; i < size; ++i) {
@@ -131,6 +139,7 @@ bool flash_write_32(uint32_t flash_address, uint32_t data) {
 
 //  ***************************************************************************
 /// @brief  Write bytes to flash
+/// @note   Blocking version of flash_start_write_bytes
 /// @param  flash_address: flash address
 /// @param  data: data for write
 /// @param  size: bytes count for write
@@ -138,15 +147,45 @@ bool flash_write_32(uint32_t flash_address, uint32_t data) {
 //  ***************************************************************************
 bool flash_write_bytes(uint32_t flash_address, const uint8_t* data, uint32_t size) {
     
+    if (flash_start_write_bytes(flash_address, data, size) == false) {
+        return false;
+    }
+    
+    flash_write_status_t status = flash_get_write_status();
+    while (status == FLASH_WRITE_IN_PROGRESS) {
+        status = flash_get_write_status();
+    }
+    return status == FLASH_WRITE_SUCCESS;
+}
+
+//  ***************************************************************************
+/// @brief  Start write bytes to flash
+/// @note   Page program command is started without wait and interrupts are
+///         not disabled: code is executed from bank #0 while bank #1 is
+///         programmed. Data is copied to page buffer, buffer can be reused
+///         after call. Use flash_get_write_status() for get result
+/// @param  flash_address: flash address
+/// @param  data: data for write
+/// @param  size: bytes count for write (in one page)
+/// @return true - write started, false - fail
+//  ***************************************************************************
+bool flash_start_write_bytes(uint32_t flash_address, const uint8_t* data, uint32_t size) {
+    
     if (flash_address < FLASH_BANK1_START_ADDRESS || flash_address + size - 1 > FLASH_BANK1_END_ADDRESS) {
         return false;
     }
     
+    // Wait previous command complete
+    while (flash_get_write_status() == FLASH_WRITE_IN_PROGRESS);
+    
     
     // Get page number, inpage address and page begin address
     uint32_t page_number = (flash_address - FLASH_BANK0_START_ADDRESS) / FLASH_PAGE_SIZE;
     uint32_t page_start_address = FLASH_BANK0_START_ADDRESS + page_number * FLASH_PAGE_SIZE;
     uint32_t inpage_address = flash_address - FLASH_BANK0_START_ADDRESS - page_number * FLASH_PAGE_SIZE;
+    if (inpage_address + size > FLASH_PAGE_SIZE) {
+        return false;
+    }
     
     // Read flash data to RAM
     flash_read_bytes(page_start_address, flash_ram_buffer, FLASH_PAGE_SIZE);
@@ -165,6 +204,7 @@ bool flash_write_bytes(uint32_t flash_address, const uint8_t* data, uint32_t siz
 
     // Clear lock bit
     if (flash_execute_cmd(EEFC_FCR_FCMD_CLB, page_number) == false) {
+        write_status = FLASH_WRITE_FAIL;
         return false;
     }
     
@@ -179,40 +219,67 @@ bool flash_write_bytes(uint32_t flash_address, const uint8_t* data, uint32_t siz
         ++memory;
     }
     
-    // Write page and lock page
+    // Start write page and lock page
     REG_EFC1_FMR = EEFC_FMR_FWS(6); // According errata
-    __disable_irq();
-    if (is_need_erase == true) {
-        
-        if (flash_execute_cmd(EEFC_FCR_FCMD_EWPL, page_number) == false) {
-            return false;
-        }
+    write_page_start_address = page_start_address;
+    write_status = FLASH_WRITE_IN_PROGRESS;
+    flash_start_cmd((is_need_erase == true) ? EEFC_FCR_FCMD_EWPL : EEFC_FCR_FCMD_WPL, page_number);
+    
+    return true;
+}
+
+//  ***************************************************************************
+/// @brief  Get flash write status
+/// @note   Write result is checked on command complete
+/// @param  none
+/// @return Status of last write
+//  ***************************************************************************
+flash_write_status_t flash_get_write_status(void) {
+    
+    if (write_status != FLASH_WRITE_IN_PROGRESS) {
+        return write_status;
     }
-    else {
-        
-        if (flash_execute_cmd(EEFC_FCR_FCMD_WPL, page_number) == false) {
-            return false;
-        }
+    
+    uint32_t status = REG_EFC1_FSR;
+    if ((status & EEFC_FSR_FRDY) != EEFC_FSR_FRDY) {
+        return FLASH_WRITE_IN_PROGRESS;
     }
-    __enable_irq();
     REG_EFC1_FMR = EEFC_FMR_FWS(4); // Restore to default
     
-    // Check written data
-    for (uint32_t i = 0; i < size; ++i) {
+    // Check command result and written data
+    write_status = FLASH_WRITE_SUCCESS;
+    if ((status & (EEFC_FSR_FCMDE | EEFC_FSR_FLOCKE)) != 0) {
+        write_status = FLASH_WRITE_FAIL;
+    }
+    for (uint32_t i = 0; i < FLASH_PAGE_SIZE && write_status == FLASH_WRITE_SUCCESS; ++i) {
         
-        uint8_t byte = flash_read_8(page_start_address + i);
+        uint8_t byte = flash_read_8(write_page_start_address + i);
         if (byte != flash_ram_buffer[i]) {
-            return false;
+            write_status = FLASH_WRITE_FAIL;
         }
     }
     
-    return true;
+    return write_status;
 }
 
 
 
 
 
+//  ***************************************************************************
+/// @brief  Start FLASH command
+/// @note   This function should be execute from RAM
+/// @param  cmd: flash command
+/// @param  arg: command argument
+/// @return none
+//  ***************************************************************************
+__attribute__((__noinline__)) 
+__attribute__((section(".ramfunc")))
+static void flash_start_cmd(uint32_t cmd, uint16_t arg) {
+    
+    REG_EFC1_FCR = EEFC_FCR_FKEY_PASSWD | EEFC_FCR_FARG(arg) | cmd;
+}
+
 //  ***************************************************************************
 /// @brief  Execute FLASH command
 /// @note   This function should be execute from RAM
@@ -2,6 +2,8 @@
 /// @file    flash.h
 /// @author  NeoProg
 /// @brief   Internal flash driver (only BANK1 flash memory)
+/// @note    Firmware should be placed in BANK0: BANK1 is programmed without
+///          stop of code execution and interrupts
 //  ***************************************************************************
 #ifndef FLASH_H_
 #define FLASH_H_
@@ -15,6 +17,13 @@
 #define FLASH_PAGE_SIZE                     (IFLASH1_PAGE_SIZE)
 
 
+typedef enum {
+    FLASH_WRITE_IN_PROGRESS,
+    FLASH_WRITE_SUCCESS,
+    FLASH_WRITE_FAIL
+} flash_write_status_t;
+
+
 void flash_init(void);
 
 uint8_t flash_read_8(uint32_t flash_address);
@@ -27,5 +36,8 @@ bool flash_write_16(uint32_t flash_address, uint16_t data);
 bool flash_write_32(uint32_t flash_address, uint32_t data);
 bool flash_write_bytes(uint32_t flash_address, const uint8_t* data, uint32_t size);
 
+bool flash_start_write_bytes(uint32_t flash_address, const uint8_t* data, uint32_t size);
+flash_write_status_t flash_get_write_status(void);
+
 
 #endif /* FLASH_H_ */
\ No newline at end of file
@@ -12,22 +12,28 @@
 #define SDA_PIN                             (PIO_PB12)
 #define SCK_PIN                             (PIO_PB13)
 #define MAX_BUFFER_SIZE                     (150)
+#define QUEUE_SIZE                          (8)     // Transactions count for each priority
 #define I2C_TIMEOUT_MS                      (50)
-
-typedef enum {
-    I2C_DRIVER_NO_ERROR,
-    I2C_DRIVER_BUSY,
-    I2C_DRIVER_ERROR
-} driver_status_t;
-
+#define BUS_RECOVERY_HALF_PERIOD_US         (5)     // 100 kHz SCL pulses for release SDA
 
 static uint8_t tx_buffer[MAX_BUFFER_SIZE] = { 0 };
 static uint8_t rx_buffer[MAX_BUFFER_SIZE] = { 0 };
 
+static i2c_transaction_t* queue[I2C_PRIORITY_COUNT][QUEUE_SIZE] = { 0 };
+static uint32_t queue_head[I2C_PRIORITY_COUNT] = { 0 };
+static uint32_t queue_length[I2C_PRIORITY_COUNT] = { 0 };
+
+static i2c_transaction_t* volatile active_transaction = NULL;
 static uint32_t start_operation_time = 0;
-static volatile driver_status_t driver_status = I2C_DRIVER_NO_ERROR;
 
+static i2c_transaction_t async_transaction = { 0 };     // For i2c_async_xxx() functions
 
+
+static void start_next_transaction(void);
+static void complete_transaction(i2c_transaction_status_t status);
+static void check_timeout(void);
+static bool transfer(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_addr_length, uint8_t* buffer, uint32_t bytes_count, bool is_read);
+static bool start_async_transfer(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_addr_length, uint8_t* buffer, uint32_t bytes_count, bool is_read);
 static void stop_communication(void);
 
 
@@ -56,9 +62,9 @@ void i2c_init(i2c_speed_t speed) {
     for (uint32_t i = 0; i < 9; ++i) {
         
         REG_PIOB_CODR = SCK_PIN;
-        delay_ms(1);
+        delay_us(BUS_RECOVERY_HALF_PERIOD_US);
         REG_PIOB_SODR = SCK_PIN;
-        delay_ms(1);
+        delay_us(BUS_RECOVERY_HALF_PERIOD_US);
     }
 
     // Configure SCK and SDA as A peripheral function
@@ -74,21 +80,73 @@ void i2c_init(i2c_speed_t speed) {
 }
 
 //  ***************************************************************************
-/// @brief    Check asynchronous operation complete
+/// @brief    I2C driver process
+/// @note     Abort hung transaction and start next queued transaction
 /// @param    none
-/// @return    true - operation complete, false - operation in progress
+/// @return    none
 //  ***************************************************************************
-bool i2c_is_async_operation_complete(void) {
+void i2c_process(void) {
+    
+    check_timeout();
+}
+
+//  ***************************************************************************
+/// @brief    Put transaction to queue
+/// @note     Transactions of one priority are executed in submit order.
+///           Transaction descriptor should be valid until transaction complete
+/// @param    transaction: transaction descriptor
+/// @param    priority: transaction priority
+/// @return    true - transaction queued, false - queue is full or transaction already queued
+//  ***************************************************************************
+bool i2c_submit_transaction(i2c_transaction_t* transaction, i2c_priority_t priority) {
+    
+    if (priority >= I2C_PRIORITY_COUNT || transaction->bytes_count == 0) {
+        return false;
+    }
+    
+    // Function can be called from transaction callback (ISR context)
+    bool is_queued = false;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
     
-    if (driver_status == I2C_DRIVER_BUSY) {
+    if (queue_length[priority] < QUEUE_SIZE &&
+        transaction->status != I2C_TRANSACTION_QUEUED && transaction->status != I2C_TRANSACTION_IN_PROGRESS) {
         
-        if (get_time_ms() - start_operation_time > I2C_TIMEOUT_MS) {
-            stop_communication();
-            driver_status = I2C_DRIVER_ERROR;
+        uint32_t tail = (queue_head[priority] + queue_length[priority]) % QUEUE_SIZE;
+        queue[priority][tail] = transaction;
+        ++queue_length[priority];
+        
+        transaction->status = I2C_TRANSACTION_QUEUED;
+        is_queued = true;
+        
+        if (active_transaction == NULL) {
+            start_next_transaction();
         }
     }
+    
+    __set_PRIMASK(primask);
+    return is_queued;
+}
 
-    return driver_status != I2C_DRIVER_BUSY;
+//  ***************************************************************************
+/// @brief    Check transaction complete
+/// @param    transaction: transaction descriptor
+/// @return    true - transaction complete (see status), false - transaction queued or in progress
+//  ***************************************************************************
+bool i2c_is_transaction_complete(const i2c_transaction_t* transaction) {
+    
+    check_timeout();
+    return transaction->status != I2C_TRANSACTION_QUEUED && transaction->status != I2C_TRANSACTION_IN_PROGRESS;
+}
+
+//  ***************************************************************************
+/// @brief    Check asynchronous operation complete
+/// @param    none
+/// @return    true - operation complete, false - operation in progress
+//  ***************************************************************************
+bool i2c_is_async_operation_complete(void) {
+    
+    return i2c_is_transaction_complete(&async_transaction);
 }
 
 //  ***************************************************************************
@@ -98,7 +156,7 @@ bool i2c_is_async_operation_complete(void) {
 //  ***************************************************************************
 bool i2c_get_async_operation_status(void) {
     
-    return driver_status == I2C_DRIVER_NO_ERROR;
+    return async_transaction.status != I2C_TRANSACTION_FAIL;
 }
 
 
@@ -138,6 +196,7 @@ bool i2c_write_byte(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_a
 
 //  ***************************************************************************
 /// @brief    Synchronous write data
+/// @note     Transaction is queued with high priority. Transfers in progress are not aborted
 /// @param    dev_addr: I2C device address
 /// @param    internal_addr: internal address on I2C device
 /// @param  internal_addr_length: internal address length
@@ -146,16 +205,7 @@ bool i2c_write_byte(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_a
 //  ***************************************************************************
 bool i2c_write_bytes(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_addr_length, uint8_t* data, uint32_t bytes_count) {
 
-    // Disable all current I2C communications and reset driver status
-    stop_communication();
-    driver_status = I2C_DRIVER_NO_ERROR;
-
-    // Start transmit data and wait communication complete
-    i2c_async_write_bytes(dev_addr, internal_addr, internal_addr_length, data, bytes_count);
-    while (i2c_is_async_operation_complete() == false);
-
-    // Return operation status
-    return i2c_get_async_operation_status();
+    return transfer(dev_addr, internal_addr, internal_addr_length, (data == NULL) ? tx_buffer : data, bytes_count, false);
 }
 
 //  ***************************************************************************
@@ -168,31 +218,7 @@ bool i2c_write_bytes(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_
 //  ***************************************************************************
 bool i2c_async_write_bytes(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_addr_length, uint8_t* data, uint32_t bytes_count) {
 
-    // Check driver state
-    if (i2c_is_async_operation_complete() == false) {
-        return false;
-    }
-
-    // Disable all I2C interrupts
-    REG_TWI1_IDR = 0xFFFFFFFF;
-
-    // Configure TX PDC channel
-    REG_TWI1_TPR = ((data == NULL) ? (uint32_t)tx_buffer : (uint32_t)data);
-    REG_TWI1_TCR = bytes_count;
-
-    // Configure Master mode (DADR | write mode | internal address length)
-    REG_TWI1_MMR = (dev_addr << 16) | (0 << 12) | (internal_addr_length << 8);
-    REG_TWI1_IADR = internal_addr;
-
-    // Enable transmitter
-    REG_TWI1_PTCR = TWI_PTCR_TXTEN | TWI_PTCR_RXTDIS;
-
-    // Configure interrupts
-    REG_TWI1_IER = TWI_IER_ENDTX | TWI_IER_NACK;
-
-    driver_status = I2C_DRIVER_BUSY;
-    start_operation_time = get_time_ms();
-    return true;
+    return start_async_transfer(dev_addr, internal_addr, internal_addr_length, (data == NULL) ? tx_buffer : data, bytes_count, false);
 }
 
 
@@ -211,7 +237,7 @@ bool i2c_read_byte(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_ad
 
 //  ***************************************************************************
 /// @brief    Synchronous read data
-/// @note    This wrappers for asynchronous mode functions
+/// @note     Transaction is queued with high priority. Transfers in progress are not aborted
 /// @param    dev_addr: I2C device address
 /// @param    internal_addr: internal register address on I2C device
 /// @param    data: pointer to receive buffer
@@ -220,16 +246,7 @@ bool i2c_read_byte(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_ad
 //  ***************************************************************************
 bool i2c_read_bytes(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_addr_length, uint8_t* buffer, uint32_t bytes_count) {
 
-    // Disable all current I2C communications
-    stop_communication();
-    driver_status = I2C_DRIVER_NO_ERROR;
-
-    // Start receive data and wait communication complete
-    i2c_async_read_bytes(dev_addr, internal_addr, internal_addr_length, buffer, bytes_count);
-    while (i2c_is_async_operation_complete() == false);
-
-    // Return operation status
-    return i2c_get_async_operation_status();
+    return transfer(dev_addr, internal_addr, internal_addr_length, (buffer == NULL) ? rx_buffer : buffer, bytes_count, true);
 }
 
 //  ***************************************************************************
@@ -243,57 +260,189 @@ bool i2c_read_bytes(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_a
 //  ***************************************************************************
 bool i2c_async_read_bytes(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_addr_length, uint8_t* buffer, uint32_t bytes_count) {
 
-    // Check driver state
-    if (driver_status == I2C_DRIVER_BUSY) {
-        return false;
+    return start_async_transfer(dev_addr, internal_addr, internal_addr_length, (buffer == NULL) ? rx_buffer : buffer, bytes_count, true);
+}
+
+
+
+//  ***************************************************************************
+/// @brief  Get internal TX buffer address
+/// @return    Buffer address
+//  ***************************************************************************
+uint8_t* i2c_get_internal_tx_buffer_address(void) {
+    
+    return tx_buffer;
+}
+
+//  ***************************************************************************
+/// @brief  Get internal RX buffer address
+/// @return    Buffer address
+//  ***************************************************************************
+uint8_t* i2c_get_internal_rx_buffer_address(void) {
+    
+    return rx_buffer;
+}
+
+
+
+//  ***************************************************************************
+/// @brief  Start next queued transaction
+/// @note   Call with disabled interrupts or from ISR
+/// @param    None
+/// @return    None
+//  ***************************************************************************
+static void start_next_transaction(void) {
+    
+    active_transaction = NULL;
+    for (uint32_t i = 0; i < I2C_PRIORITY_COUNT; ++i) {
+        
+        if (queue_length[i] != 0) {
+            active_transaction = queue[i][queue_head[i]];
+            queue_head[i] = (queue_head[i] + 1) % QUEUE_SIZE;
+            --queue_length[i];
+            break;
+        }
+    }
+    if (active_transaction == NULL) {
+        return;
     }
+    
+    i2c_transaction_t* t = active_transaction;
+    t->status = I2C_TRANSACTION_IN_PROGRESS;
+    start_operation_time = get_time_ms();
 
     // Disable all I2C interrupts
     REG_TWI1_IDR = 0xFFFFFFFF;
     
-    // Configure RX PDC channel
-    REG_TWI1_RPR = ((buffer == NULL) ? (uint32_t)tx_buffer : (uint32_t)buffer);
-    REG_TWI1_RCR = bytes_count - 1; // Without last byte (for send STOP)
+    if (t->is_read == false) {
+        
+        // Configure TX PDC channel
+        REG_TWI1_TPR = (uint32_t)t->buffer;
+        REG_TWI1_TCR = t->bytes_count;
 
-    // Configure Master mode (DADR | read mode | internal address length)
-    REG_TWI1_MMR = (dev_addr << 16) | TWI_MMR_MREAD | (internal_addr_length << 8);
-    REG_TWI1_IADR = internal_addr;
+        // Configure Master mode (DADR | write mode | internal address length)
+        REG_TWI1_MMR = (t->dev_addr << 16) | (0 << 12) | (t->internal_addr_length << 8);
+        REG_TWI1_IADR = t->internal_addr;
 
-    // Enable receiver
-    REG_TWI1_PTCR = TWI_PTCR_TXTDIS | TWI_PTCR_RXTEN;
+        // Enable transmitter
+        REG_TWI1_PTCR = TWI_PTCR_TXTEN | TWI_PTCR_RXTDIS;
 
-    // Send START
-    REG_TWI1_CR = TWI_CR_START;
+        // Configure interrupts
+        REG_TWI1_IER = TWI_IER_ENDTX | TWI_IER_NACK;
+    }
+    else {
+        
+        // Configure RX PDC channel
+        REG_TWI1_RPR = (uint32_t)t->buffer;
+        REG_TWI1_RCR = t->bytes_count - 1; // Without last byte (for send STOP)
 
-    // Configure interrupts
-    REG_TWI1_IER = TWI_IER_ENDRX | TWI_IER_NACK;
+        // Configure Master mode (DADR | read mode | internal address length)
+        REG_TWI1_MMR = (t->dev_addr << 16) | TWI_MMR_MREAD | (t->internal_addr_length << 8);
+        REG_TWI1_IADR = t->internal_addr;
 
-    driver_status = I2C_DRIVER_BUSY;
-    start_operation_time = get_time_ms();
-    return true;
-}
+        // Enable receiver
+        REG_TWI1_PTCR = TWI_PTCR_TXTDIS | TWI_PTCR_RXTEN;
 
+        // Send START
+        REG_TWI1_CR = TWI_CR_START;
 
+        // Configure interrupts
+        REG_TWI1_IER = TWI_IER_ENDRX | TWI_IER_NACK;
+    }
+}
 
 //  ***************************************************************************
-/// @brief  Get internal TX buffer address
-/// @return    Buffer address
+/// @brief  Complete active transaction and start next
+/// @note   Call with disabled interrupts or from ISR
+/// @param    status: transaction status
+/// @return    None
 //  ***************************************************************************
-uint8_t* i2c_get_internal_tx_buffer_address(void) {
+static void complete_transaction(i2c_transaction_status_t status) {
     
-    return tx_buffer;
+    stop_communication();
+    
+    i2c_transaction_t* t = active_transaction;
+    if (t != NULL) {
+        t->status = status;
+        if (t->callback != NULL) {
+            t->callback(t);
+        }
+    }
+    start_next_transaction();
 }
 
 //  ***************************************************************************
-/// @brief  Get internal RX buffer address
-/// @return    Buffer address
+/// @brief  Abort active transaction by timeout
+/// @param    None
+/// @return    None
 //  ***************************************************************************
-uint8_t* i2c_get_internal_rx_buffer_address(void) {
+static void check_timeout(void) {
     
-    return rx_buffer;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (active_transaction != NULL && get_time_ms() - start_operation_time > I2C_TIMEOUT_MS) {
+        complete_transaction(I2C_TRANSACTION_FAIL);
+    }
+    __set_PRIMASK(primask);
 }
 
+//  ***************************************************************************
+/// @brief  Synchronous transfer
+/// @param    dev_addr: I2C device address
+/// @param    internal_addr: internal register address on I2C device
+/// @param  internal_addr_length: internal address length
+/// @param    buffer: pointer to data
+/// @param    bytes_count: bytes count
+/// @param    is_read: true - read, false - write
+/// @return    true - no error, false - error
+//  ***************************************************************************
+static bool transfer(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_addr_length, uint8_t* buffer, uint32_t bytes_count, bool is_read) {
+    
+    i2c_transaction_t transaction = {
+        .dev_addr = dev_addr,
+        .internal_addr_length = internal_addr_length,
+        .is_read = is_read,
+        .internal_addr = internal_addr,
+        .buffer = buffer,
+        .bytes_count = bytes_count,
+        .callback = NULL,
+        .status = I2C_TRANSACTION_IDLE
+    };
+    
+    if (i2c_submit_transaction(&transaction, I2C_PRIORITY_HIGH) == false) {
+        return false;
+    }
+    while (i2c_is_transaction_complete(&transaction) == false);
+    
+    return transaction.status == I2C_TRANSACTION_SUCCESS;
+}
 
+//  ***************************************************************************
+/// @brief  Start asynchronous transfer by internal descriptor
+/// @param    dev_addr: I2C device address
+/// @param    internal_addr: internal register address on I2C device
+/// @param  internal_addr_length: internal address length
+/// @param    buffer: pointer to data
+/// @param    bytes_count: bytes count
+/// @param    is_read: true - read, false - write
+/// @return    true - operation start success, false - operation start fail
+//  ***************************************************************************
+static bool start_async_transfer(uint8_t dev_addr, uint32_t internal_addr, uint8_t internal_addr_length, uint8_t* buffer, uint32_t bytes_count, bool is_read) {
+    
+    // Check previous operation complete
+    if (i2c_is_async_operation_complete() == false) {
+        return false;
+    }
+    
+    async_transaction.dev_addr = dev_addr;
+    async_transaction.internal_addr_length = internal_addr_length;
+    async_transaction.is_read = is_read;
+    async_transaction.internal_addr = internal_addr;
+    async_transaction.buffer = buffer;
+    async_transaction.bytes_count = bytes_count;
+    async_transaction.callback = NULL;
+    return i2c_submit_transaction(&async_transaction, I2C_PRIORITY_LOW);
+}
 
 //  ***************************************************************************
 /// @brief  Stop communication
@@ -327,14 +476,12 @@ void TWI1_Handler(void) {
 
     // Errors
     if (IS_BIT_SET(status, TWI_SR_NACK) && IS_BIT_SET(irq_mask, TWI_IMR_NACK)) {
-        stop_communication();
-        driver_status = I2C_DRIVER_ERROR;
+        complete_transaction(I2C_TRANSACTION_FAIL);
     }
     
     // Send STOP complete
     else if (IS_BIT_SET(status, TWI_SR_TXCOMP) && IS_BIT_SET(irq_mask, TWI_IMR_TXCOMP)) {
-        stop_communication();
-        driver_status = I2C_DRIVER_NO_ERROR;
+        complete_transaction(I2C_TRANSACTION_SUCCESS);
     }
 
     // TX handler
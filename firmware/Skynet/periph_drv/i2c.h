@@ -15,8 +15,37 @@ typedef enum {
     I2C_SPEED_400KHZ = 0x6565
 } i2c_speed_t;
 
+typedef enum {
+    I2C_PRIORITY_HIGH,                  // Synchronous operations and time critical sensors
+    I2C_PRIORITY_LOW,                   // Bulk transfers (display)
+    I2C_PRIORITY_COUNT
+} i2c_priority_t;
+
+typedef enum {
+    I2C_TRANSACTION_IDLE,
+    I2C_TRANSACTION_QUEUED,
+    I2C_TRANSACTION_IN_PROGRESS,
+    I2C_TRANSACTION_SUCCESS,
+    I2C_TRANSACTION_FAIL
+} i2c_transaction_status_t;
+
+typedef struct i2c_transaction {
+    uint8_t  dev_addr;                  // I2C device address
+    uint8_t  internal_addr_length;      // Internal address length [0; 3]
+    bool     is_read;                   // Transfer direction
+    uint32_t internal_addr;             // Internal address on I2C device
+    uint8_t* buffer;                    // Data buffer. Should be valid until transaction complete
+    uint32_t bytes_count;               // Bytes count for transfer
+    void   (*callback)(struct i2c_transaction* transaction); // Call from ISR after transaction complete (can be NULL)
+    volatile i2c_transaction_status_t status;
+} i2c_transaction_t;
+
 
 extern void i2c_init(i2c_speed_t speed);
+extern void i2c_process(void);
+
+extern bool i2c_submit_transaction(i2c_transaction_t* transaction, i2c_priority_t priority);
+extern bool i2c_is_transaction_complete(const i2c_transaction_t* transaction);
 
 extern bool i2c_is_async_operation_complete(void);
 extern bool i2c_get_async_operation_status(void);
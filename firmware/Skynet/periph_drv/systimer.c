@@ -61,6 +61,17 @@ void delay_ms(uint32_t ms) {
     while (systime_ms - start < ms);
 }
 
+//  ***************************************************************************
+/// @brief  Synchronous short delay
+/// @param  us: time delay [us]
+/// @return none
+//  ***************************************************************************
+void delay_us(uint32_t us) {
+    
+    uint32_t start = get_time_us();
+    while (get_time_us() - start < us);
+}
+
 
 
 //  ***************************************************************************
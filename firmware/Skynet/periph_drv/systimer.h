@@ -8,9 +8,10 @@
 
 
 extern void systimer_init(void);
-extern uint32_t get_time_ms(void);
-extern uint32_t get_time_us(void);
+extern uint32_t get_time_ms(void);
+extern uint32_t get_time_us(void);
 extern void delay_ms(uint32_t ms);
+extern void delay_us(uint32_t us);
 
 
 #endif /* SYSTIMER_H_ */
\ No newline at end of file
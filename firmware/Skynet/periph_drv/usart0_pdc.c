@@ -7,12 +7,20 @@
 #include "usart0_pdc.h"
 #define TX_PIN                              (PIO_PA11)
 #define RX_PIN                              (PIO_PA10)
-#define INTERNAL_TX_BUFFER_SIZE             (128)
-#define INTERNAL_RX_BUFFER_SIZE             (128)
+#define INTERNAL_TX_BUFFER_SIZE             (USART0_FRAME_BUFFER_SIZE)
+#define INTERNAL_RX_BUFFER_SIZE             (USART0_FRAME_BUFFER_SIZE)
+#define TX_BUFFER_COUNT                     (2)     // Current and next PDC buffers
+#define RX_BUFFER_COUNT                     (4)     // Should be power of 2
 
 
-static uint8_t internal_tx_buffer[INTERNAL_TX_BUFFER_SIZE] = { 0 };
-static uint8_t internal_rx_buffer[INTERNAL_RX_BUFFER_SIZE] = { 0 };
+static uint8_t internal_tx_buffer[TX_BUFFER_COUNT][INTERNAL_TX_BUFFER_SIZE] = { 0 };
+static uint8_t internal_rx_buffer[RX_BUFFER_COUNT][INTERNAL_RX_BUFFER_SIZE] = { 0 };
+
+static uint32_t tx_free_buffer = 0;                             // TX buffer for fill next frame
+
+static volatile uint32_t rx_frame_size[RX_BUFFER_COUNT] = { 0 };
+static volatile uint32_t rx_head = 0;                           // Receiving buffer (changed by ISR only)
+static volatile uint32_t rx_tail = 0;                           // Oldest received frame (changed by main loop only)
 
 
 //  ***************************************************************************
@@ -53,9 +61,10 @@ void usart0_init(uint32_t baud_rate) {
 
     // Configure PDC channels
     REG_USART0_TCR = 0;
-    REG_USART0_TPR = (uint32_t)internal_tx_buffer;
+    REG_USART0_TNCR = 0;
     REG_USART0_RCR = 0;
-    REG_USART0_RPR = (uint32_t)internal_rx_buffer;
+    REG_USART0_RNCR = 0;
+    tx_free_buffer = 0;
 
     // Configure baud rate
     usart0_set_baud_rate(baud_rate);
@@ -122,7 +131,8 @@ void usart0_reset(bool is_reset_transmitter, bool is_reset_receiver) {
 
         // Reset PDC channel
         REG_USART0_TCR = 0;
-        REG_USART0_TPR = (uint32_t)internal_tx_buffer;
+        REG_USART0_TNCR = 0;
+        tx_free_buffer = 0;
 
         // Enable TX
         REG_USART0_CR = US_CR_TXEN;
@@ -139,7 +149,7 @@ void usart0_reset(bool is_reset_transmitter, bool is_reset_receiver) {
 
         // Reset PDC channel
         REG_USART0_RCR = 0;
-        REG_USART0_RPR = (uint32_t)internal_rx_buffer;
+        REG_USART0_RNCR = 0;
 
         // Enable RX
         REG_USART0_CR = US_CR_RXEN;
@@ -148,6 +158,7 @@ void usart0_reset(bool is_reset_transmitter, bool is_reset_receiver) {
 
 //  ***************************************************************************
 /// @brief    Start asynchronous transmit
+/// @note    Frame is placed to next PDC buffer if previous frame is transmitting
 /// @param    bytes_count: bytes count for transmit
 //  ***************************************************************************
 void usart0_start_tx(uint32_t bytes_count) {
@@ -155,43 +166,63 @@ void usart0_start_tx(uint32_t bytes_count) {
     if (bytes_count > INTERNAL_TX_BUFFER_SIZE) {
         bytes_count = INTERNAL_TX_BUFFER_SIZE;
     }
-
-    // Initialize DMA for transfer 
+    
+    // Initialize DMA for transfer. DMA disabled while configuration for avoid load next buffer during check
     REG_USART0_PTCR = US_PTCR_TXTDIS;
-    REG_USART0_TPR = (uint32_t)internal_tx_buffer;
-    REG_USART0_TCR = bytes_count;
+    if (REG_USART0_TCR == 0) {
+        REG_USART0_TPR = (uint32_t)internal_tx_buffer[tx_free_buffer];
+        REG_USART0_TCR = bytes_count;
+    }
+    else {
+        REG_USART0_TNPR = (uint32_t)internal_tx_buffer[tx_free_buffer];
+        REG_USART0_TNCR = bytes_count;
+    }
     REG_USART0_PTCR = US_PTCR_TXTEN;
+    
+    tx_free_buffer = (tx_free_buffer + 1) % TX_BUFFER_COUNT;
 }
 
 //  ***************************************************************************
 /// @brief    Check transmit complete
-/// @return None
+/// @return true - all frames transmitted, false - transmit in progress
 //  ***************************************************************************
 bool usart0_is_tx_complete(void) {
     uint32_t reg = REG_USART0_CSR;
     return (reg & US_CSR_TXEMPTY);
 }
 
+//  ***************************************************************************
+/// @brief    Check TX buffer is free for next frame
+/// @return true - buffer free, false - current and next PDC buffers are busy
+//  ***************************************************************************
+bool usart0_is_tx_buffer_free(void) {
+    return REG_USART0_TNCR == 0;
+}
+
 //  ***************************************************************************
 /// @brief    Get internal TX buffer address
+/// @note    Buffer is not used by DMA if usart0_is_tx_buffer_free() returns true
 /// @return Buffer address
 //  ***************************************************************************
 uint8_t* usart0_get_internal_tx_buffer_address(void) {
-    return internal_tx_buffer;
+    return internal_tx_buffer[tx_free_buffer];
 }
 
 
 
 //  ***************************************************************************
 /// @brief    Start asynchronous receive
-/// @param  external_rx_buffer: pointer to external buffer
-/// @param  external_buffer_size: external buffer size
+/// @note    Received frames are placed to RX buffers ring. All unprocessed frames are dropped
 /// @param    none
 //  ***************************************************************************
-void usart0_start_rx(uint8_t* external_rx_buffer, uint32_t external_buffer_size) {
+void usart0_start_rx(void) {
 
     // Disable DMA
     REG_USART0_PTCR = US_PTCR_RXTDIS;
+    
+    // Clear RX buffers ring
+    rx_head = 0;
+    rx_tail = 0;
 
     // Initialize frame timeout
     REG_USART0_RTOR = 35 * 8;
@@ -199,14 +230,8 @@ void usart0_start_rx(uint8_t* external_rx_buffer, uint32_t external_buffer_size)
     REG_USART0_IER = US_IER_TIMEOUT;
     
     // Initialize DMA for receive
-    if (external_rx_buffer == USART0_USE_INTERNAL_BUFFER) {
-        REG_USART0_RPR = (uint32_t)internal_rx_buffer;
-        REG_USART0_RCR = INTERNAL_RX_BUFFER_SIZE;
-    }
-    else {
-        REG_USART0_RPR = (uint32_t)external_rx_buffer;
-        REG_USART0_RCR = external_buffer_size;
-    }
+    REG_USART0_RPR = (uint32_t)internal_rx_buffer[0];
+    REG_USART0_RCR = INTERNAL_RX_BUFFER_SIZE;
 
     // Enable DMA
     REG_USART0_PTCR = US_PTCR_RXTEN;
@@ -217,24 +242,34 @@ void usart0_start_rx(uint8_t* external_rx_buffer, uint32_t external_buffer_size)
 /// @return    true - frame received, false - no
 //  ***************************************************************************
 bool usart0_is_frame_received(void) {
-    uint32_t reg = REG_USART0_CSR;
-    return reg & US_CSR_TIMEOUT;
+    return rx_head != rx_tail;
 }
 
 //  ***************************************************************************
 /// @brief    Get received frame size
-/// @return    Frame size
+/// @return    Frame size of oldest received frame
 //  ***************************************************************************
 uint32_t usart0_get_frame_size(void) {
-    return INTERNAL_RX_BUFFER_SIZE - REG_USART0_RCR;
+    return rx_frame_size[rx_tail & (RX_BUFFER_COUNT - 1)];
 }
 
 //  ***************************************************************************
 /// @brief    Get internal RX buffer address
-/// @return Buffer address
+/// @return Buffer address of oldest received frame
 //  ***************************************************************************
 const uint8_t* usart0_get_internal_rx_buffer_address(void) {
-    return internal_rx_buffer;
+    return internal_rx_buffer[rx_tail & (RX_BUFFER_COUNT - 1)];
+}
+
+//  ***************************************************************************
+/// @brief    Release oldest received frame buffer
+/// @param    none
+//  ***************************************************************************
+void usart0_release_frame(void) {
+    
+    if (rx_head != rx_tail) {
+        ++rx_tail;
+    }
 }
 
 
@@ -245,7 +280,19 @@ const uint8_t* usart0_get_internal_rx_buffer_address(void) {
 //  ***************************************************************************
 void USART0_Handler(void) {
     
-    // Frame received - disable DMA and frame timeout IRQ
-    REG_USART0_IDR = US_IDR_TIMEOUT;
+    // Frame received - stop DMA and save frame size
     REG_USART0_PTCR = US_PTCR_RXTDIS;
+    uint32_t frame_size = INTERNAL_RX_BUFFER_SIZE - REG_USART0_RCR;
+    
+    // Switch DMA to next RX buffer if it free. Otherwise frame is dropped and buffer is reused
+    if (frame_size != 0 && rx_head - rx_tail < RX_BUFFER_COUNT - 1) {
+        rx_frame_size[rx_head & (RX_BUFFER_COUNT - 1)] = frame_size;
+        ++rx_head;
+    }
+    REG_USART0_RPR = (uint32_t)internal_rx_buffer[rx_head & (RX_BUFFER_COUNT - 1)];
+    REG_USART0_RCR = INTERNAL_RX_BUFFER_SIZE;
+    
+    // Wait next frame
+    REG_USART0_CR = US_CR_STTTO;
+    REG_USART0_PTCR = US_PTCR_RXTEN;
 }
\ No newline at end of file
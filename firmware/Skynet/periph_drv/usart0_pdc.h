@@ -9,7 +9,7 @@
 #include <stdbool.h>
 
 
-#define USART0_USE_INTERNAL_BUFFER            (0x00000000)
+#define USART0_FRAME_BUFFER_SIZE              (128)
 
 
 void           usart0_init(uint32_t baud_rate);
@@ -19,12 +19,14 @@ bool           usart0_is_error(void);
 
 void           usart0_start_tx(uint32_t bytes_count);
 bool           usart0_is_tx_complete(void);
+bool           usart0_is_tx_buffer_free(void);
 uint8_t*       usart0_get_internal_tx_buffer_address(void);
 
-void           usart0_start_rx(uint8_t* external_rx_buffer, uint32_t external_buffer_size);
+void           usart0_start_rx(void);
 bool           usart0_is_frame_received(void);
 uint32_t       usart0_get_frame_size(void);
 const uint8_t* usart0_get_internal_rx_buffer_address(void);
+void           usart0_release_frame(void);
 
 
 #endif // USART0_PDC_H_
\ No newline at end of file
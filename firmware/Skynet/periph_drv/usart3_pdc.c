@@ -5,14 +5,33 @@
 #include <sam.h>
 #include <stdbool.h>
 #include "usart3_pdc.h"
+#include "crc16.h"
 #define TX_PIN                              (PIO_PD4)
 #define RX_PIN                              (PIO_PD5)
-#define INTERNAL_TX_BUFFER_SIZE             (128)
-#define INTERNAL_RX_BUFFER_SIZE             (128)
+#define INTERNAL_TX_BUFFER_SIZE             (USART3_FRAME_BUFFER_SIZE)
+#define INTERNAL_RX_BUFFER_SIZE             (USART3_FRAME_BUFFER_SIZE)
+#define TX_BUFFER_COUNT                     (2)     // Current and next PDC buffers
+#define RX_BUFFER_COUNT                     (4)     // Should be power of 2
 
 
-static uint8_t internal_tx_buffer[INTERNAL_TX_BUFFER_SIZE] = { 0 };
-static uint8_t internal_rx_buffer[INTERNAL_RX_BUFFER_SIZE] = { 0 };
+static uint8_t internal_tx_buffer[TX_BUFFER_COUNT][INTERNAL_TX_BUFFER_SIZE] = { 0 };
+static uint8_t internal_rx_buffer[RX_BUFFER_COUNT][INTERNAL_RX_BUFFER_SIZE] = { 0 };
+
+static uint32_t tx_free_buffer = 0;                             // TX buffer for fill next frame
+
+static volatile uint32_t rx_frame_size[RX_BUFFER_COUNT] = { 0 };
+static volatile uint32_t rx_head = 0;                           // Receiving buffer (changed by ISR only)
+static volatile uint32_t rx_tail = 0;                           // Oldest buffer used by main loop (changed by main loop only)
+static uint32_t rx_read = 0;                                    // Oldest received frame (rx_tail != rx_read while frame transmitting from RX buffer)
+static bool is_rx_buffer_transmitting = false;                  // Released frames are transmitting from RX buffers
+static volatile uint32_t rx_drop_count = 0;                     // Dropped frames counter (changed by ISR only)
+
+// CRC16 of frames is calculated in background while frame is receiving
+static uint16_t rx_frame_crc[RX_BUFFER_COUNT] = { 0 };
+static uint32_t crc_frame = 0;                                  // Frame for which CRC is calculating
+static uint32_t crc_offset = 0;                                 // Bytes count of frame added to CRC
+static uint16_t crc_value = CRC16_INITIAL_VALUE;
+static uint32_t crc_drop_count = 0;
 
 
 //  ***************************************************************************
@@ -46,16 +65,17 @@ void usart3_init(uint32_t baud_rate) {
 
     // Configure 8N1 mode
     REG_USART3_MR = US_MR_CHRL_8_BIT | US_MR_PAR_NO | US_MR_NBSTOP_1_BIT | US_MR_USART_MODE_NORMAL | US_MR_USCLKS_MCK | US_MR_CHMODE_NORMAL;
-
+    
     // Disable all interrupts
     REG_USART3_IDR = 0xFFFFFFFF;
     NVIC_EnableIRQ(USART3_IRQn);
 
     // Configure PDC channels
     REG_USART3_TCR = 0;
-    REG_USART3_TPR = (uint32_t)internal_tx_buffer;
+    REG_USART3_TNCR = 0;
     REG_USART3_RCR = 0;
-    REG_USART3_RPR = (uint32_t)internal_rx_buffer;
+    REG_USART3_RNCR = 0;
+    tx_free_buffer = 0;
 
     // Configure baud rate
     usart3_set_baud_rate(baud_rate);
@@ -115,21 +135,22 @@ bool usart3_is_error(void) {
 void usart3_reset(bool is_reset_transmitter, bool is_reset_receiver) {
 
     if (is_reset_transmitter == true) {
-
+        
         // Disable PDC channel and reset TX
         REG_USART3_PTCR = US_PTCR_TXTDIS;
         REG_USART3_CR = US_CR_RSTTX | US_CR_RSTSTA;
 
         // Reset PDC channel
         REG_USART3_TCR = 0;
-        REG_USART3_TPR = (uint32_t)internal_tx_buffer;
+        REG_USART3_TNCR = 0;
+        tx_free_buffer = 0;
 
         // Enable TX
         REG_USART3_CR = US_CR_TXEN;
     }
 
     if (is_reset_receiver == true) {
-
+        
         // Disable PDC channel and reset RX
         REG_USART3_PTCR = US_PTCR_RXTDIS;
         REG_USART3_CR = US_CR_RSTRX | US_CR_RSTSTA;
@@ -139,7 +160,7 @@ void usart3_reset(bool is_reset_transmitter, bool is_reset_receiver) {
 
         // Reset PDC channel
         REG_USART3_RCR = 0;
-        REG_USART3_RPR = (uint32_t)internal_rx_buffer;
+        REG_USART3_RNCR = 0;
 
         // Enable RX
         REG_USART3_CR = US_CR_RXEN;
@@ -148,6 +169,7 @@ void usart3_reset(bool is_reset_transmitter, bool is_reset_receiver) {
 
 //  ***************************************************************************
 /// @brief    Start asynchronous transmit
+/// @note    Frame is placed to next PDC buffer if previous frame is transmitting
 /// @param    bytes_count: bytes count for transmit
 //  ***************************************************************************
 void usart3_start_tx(uint32_t bytes_count) {
@@ -155,58 +177,77 @@ void usart3_start_tx(uint32_t bytes_count) {
     if (bytes_count > INTERNAL_TX_BUFFER_SIZE) {
         bytes_count = INTERNAL_TX_BUFFER_SIZE;
     }
-
-    // Initialize DMA for transfer 
+    
+    // Initialize DMA for transfer. DMA disabled while configuration for avoid load next buffer during check
     REG_USART3_PTCR = US_PTCR_TXTDIS;
-    REG_USART3_TPR = (uint32_t)internal_tx_buffer;
-    REG_USART3_TCR = bytes_count;
+    if (REG_USART3_TCR == 0) {
+        REG_USART3_TPR = (uint32_t)internal_tx_buffer[tx_free_buffer];
+        REG_USART3_TCR = bytes_count;
+    }
+    else {
+        REG_USART3_TNPR = (uint32_t)internal_tx_buffer[tx_free_buffer];
+        REG_USART3_TNCR = bytes_count;
+    }
     REG_USART3_PTCR = US_PTCR_TXTEN;
+    
+    tx_free_buffer = (tx_free_buffer + 1) % TX_BUFFER_COUNT;
 }
 
 //  ***************************************************************************
 /// @brief    Check transmit complete
-/// @return None
+/// @return true - all frames transmitted, false - transmit in progress
 //  ***************************************************************************
 bool usart3_is_tx_complete(void) {
     uint32_t reg = REG_USART3_CSR;
     return (reg & US_CSR_TXEMPTY);
 }
 
+//  ***************************************************************************
+/// @brief    Check TX buffer is free for next frame
+/// @return true - buffer free, false - current and next PDC buffers are busy
+//  ***************************************************************************
+bool usart3_is_tx_buffer_free(void) {
+    return REG_USART3_TNCR == 0;
+}
+
 //  ***************************************************************************
 /// @brief    Get internal TX buffer address
+/// @note    Buffer is not used by DMA if usart3_is_tx_buffer_free() returns true
 /// @return Buffer address
 //  ***************************************************************************
 uint8_t* usart3_get_internal_tx_buffer_address(void) {
-    return internal_tx_buffer;
+    return internal_tx_buffer[tx_free_buffer];
 }
 
 
 
 //  ***************************************************************************
 /// @brief    Start asynchronous receive
-/// @param  external_rx_buffer: pointer to external buffer
-/// @param  external_buffer_size: external buffer size
+/// @note    Received frames are placed to RX buffers ring. All unprocessed frames are dropped
 /// @param    none
 //  ***************************************************************************
-void usart3_start_rx(uint8_t* external_rx_buffer, uint32_t external_buffer_size) {
+void usart3_start_rx(void) {
 
     // Disable DMA
     REG_USART3_PTCR = US_PTCR_RXTDIS;
+    
+    // Clear RX buffers ring
+    rx_head = 0;
+    rx_tail = 0;
+    rx_read = 0;
+    is_rx_buffer_transmitting = false;
+    crc_frame = 0;
+    crc_offset = 0;
+    crc_value = CRC16_INITIAL_VALUE;
 
     // Initialize frame timeout
     REG_USART3_RTOR = 35 * 8;
     REG_USART3_CR |= US_CR_STTTO;
     REG_USART3_IER = US_IER_TIMEOUT;
-
+    
     // Initialize DMA for receive
-    if (external_rx_buffer == USART3_USE_INTERNAL_BUFFER) {
-        REG_USART3_RPR = (uint32_t)internal_rx_buffer;
-        REG_USART3_RCR = INTERNAL_RX_BUFFER_SIZE;
-    }
-    else {
-        REG_USART3_RPR = (uint32_t)external_rx_buffer;
-        REG_USART3_RCR = external_buffer_size;
-    }
+    REG_USART3_RPR = (uint32_t)internal_rx_buffer[0];
+    REG_USART3_RCR = INTERNAL_RX_BUFFER_SIZE;
 
     // Enable DMA
     REG_USART3_PTCR = US_PTCR_RXTEN;
@@ -217,24 +258,145 @@ void usart3_start_rx(uint8_t* external_rx_buffer, uint32_t external_buffer_size)
 /// @return    true - frame received, false - no
 //  ***************************************************************************
 bool usart3_is_frame_received(void) {
-    uint32_t reg = REG_USART3_CSR;
-    return reg & US_CSR_TIMEOUT;
+    
+    // Free RX buffers of transmitted frames
+    if (is_rx_buffer_transmitting == true && REG_USART3_TCR == 0 && REG_USART3_TNCR == 0) {
+        is_rx_buffer_transmitting = false;
+        rx_tail = rx_read;
+    }
+    return rx_head != rx_read;
 }
 
 //  ***************************************************************************
 /// @brief    Get received frame size
-/// @return    Frame size
+/// @return    Frame size of oldest received frame
 //  ***************************************************************************
 uint32_t usart3_get_frame_size(void) {
-    return INTERNAL_RX_BUFFER_SIZE - REG_USART3_RCR;
+    return rx_frame_size[rx_read & (RX_BUFFER_COUNT - 1)];
 }
 
 //  ***************************************************************************
 /// @brief    Get internal RX buffer address
-/// @return Buffer address
+/// @return Buffer address of oldest received frame
 //  ***************************************************************************
 const uint8_t* usart3_get_internal_rx_buffer_address(void) {
-    return internal_rx_buffer;
+    return internal_rx_buffer[rx_read & (RX_BUFFER_COUNT - 1)];
+}
+
+//  ***************************************************************************
+/// @brief    Get internal RX buffer address for build response in place
+/// @note    Use usart3_start_tx_from_rx_buffer() for transmit response
+/// @return Buffer address of oldest received frame
+//  ***************************************************************************
+uint8_t* usart3_get_internal_rx_buffer_address_for_tx(void) {
+    return internal_rx_buffer[rx_read & (RX_BUFFER_COUNT - 1)];
+}
+
+//  ***************************************************************************
+/// @brief    Start asynchronous transmit from buffer of oldest received frame
+/// @note    Frame should be released after this call. Buffer is returned
+///          to receiver after transmit complete
+/// @param    bytes_count: bytes count for transmit
+//  ***************************************************************************
+void usart3_start_tx_from_rx_buffer(uint32_t bytes_count) {
+    
+    if (rx_head == rx_read) {
+        return;
+    }
+    if (bytes_count > INTERNAL_RX_BUFFER_SIZE) {
+        bytes_count = INTERNAL_RX_BUFFER_SIZE;
+    }
+    
+    // Initialize DMA for transfer. DMA disabled while configuration for avoid load next buffer during check
+    REG_USART3_PTCR = US_PTCR_TXTDIS;
+    if (REG_USART3_TCR == 0) {
+        REG_USART3_TPR = (uint32_t)internal_rx_buffer[rx_read & (RX_BUFFER_COUNT - 1)];
+        REG_USART3_TCR = bytes_count;
+    }
+    else {
+        REG_USART3_TNPR = (uint32_t)internal_rx_buffer[rx_read & (RX_BUFFER_COUNT - 1)];
+        REG_USART3_TNCR = bytes_count;
+    }
+    REG_USART3_PTCR = US_PTCR_TXTEN;
+    
+    is_rx_buffer_transmitting = true;
+}
+
+//  ***************************************************************************
+/// @brief    Release oldest received frame buffer
+/// @param    none
+//  ***************************************************************************
+void usart3_release_frame(void) {
+    
+    if (rx_head != rx_read) {
+        ++rx_read;
+    }
+    
+    // Buffer of transmitting frame is returned to receiver after transmit complete
+    if (is_rx_buffer_transmitting == false) {
+        rx_tail = rx_read;
+    }
+    
+    // CRC calculation for released frames is not needed
+    if ((int32_t)(crc_frame - rx_read) < 0) {
+        crc_frame = rx_read;
+        crc_offset = 0;
+        crc_value = CRC16_INITIAL_VALUE;
+    }
+}
+
+//  ***************************************************************************
+/// @brief    Update CRC16 of receiving frames
+/// @note    Add received bytes to CRC. Call from main loop for calculate CRC
+///          while frame is receiving
+/// @param    none
+//  ***************************************************************************
+void usart3_update_rx_crc(void) {
+    
+    while (true) {
+        
+        // Frame dropped by ISR - calculate CRC of new frame in same buffer from begin
+        if (crc_drop_count != rx_drop_count) {
+            crc_drop_count = rx_drop_count;
+            if (crc_frame == rx_head) {
+                crc_offset = 0;
+                crc_value = CRC16_INITIAL_VALUE;
+            }
+        }
+        
+        uint32_t head = rx_head;
+        uint32_t buffer_index = crc_frame & (RX_BUFFER_COUNT - 1);
+        uint32_t received_bytes = (crc_frame == head) ? INTERNAL_RX_BUFFER_SIZE - REG_USART3_RCR : rx_frame_size[buffer_index];
+        if (received_bytes > INTERNAL_RX_BUFFER_SIZE) {
+            received_bytes = 0; // Buffer switched by ISR while read RCR
+        }
+        
+        if (received_bytes > crc_offset) {
+            crc_value = crc16_update(crc_value, &internal_rx_buffer[buffer_index][crc_offset], received_bytes - crc_offset);
+            crc_offset = received_bytes;
+        }
+        
+        if (crc_frame == head) {
+            break; // Frame receiving in progress
+        }
+        
+        // Frame received - save CRC and go to next frame
+        rx_frame_crc[buffer_index] = crc_value;
+        crc_value = CRC16_INITIAL_VALUE;
+        crc_offset = 0;
+        ++crc_frame;
+    }
+}
+
+//  ***************************************************************************
+/// @brief    Get CRC16 of oldest received frame
+/// @note    CRC16 of frame with valid CRC field is 0
+/// @return    CRC16 value
+//  ***************************************************************************
+uint16_t usart3_get_frame_crc(void) {
+    
+    usart3_update_rx_crc();
+    return rx_frame_crc[rx_read & (RX_BUFFER_COUNT - 1)];
 }
 
 
@@ -245,7 +407,22 @@ const uint8_t* usart3_get_internal_rx_buffer_address(void) {
 //  ***************************************************************************
 void USART3_Handler(void) {
     
-    // Frame received - disable DMA and frame timeout IRQ
-    REG_USART3_IDR = US_IDR_TIMEOUT;
+    // Frame received - stop DMA and save frame size
     REG_USART3_PTCR = US_PTCR_RXTDIS;
+    uint32_t frame_size = INTERNAL_RX_BUFFER_SIZE - REG_USART3_RCR;
+    
+    // Switch DMA to next RX buffer if it free. Otherwise frame is dropped and buffer is reused
+    if (frame_size != 0 && rx_head - rx_tail < RX_BUFFER_COUNT - 1) {
+        rx_frame_size[rx_head & (RX_BUFFER_COUNT - 1)] = frame_size;
+        ++rx_head;
+    }
+    else {
+        ++rx_drop_count;
+    }
+    REG_USART3_RPR = (uint32_t)internal_rx_buffer[rx_head & (RX_BUFFER_COUNT - 1)];
+    REG_USART3_RCR = INTERNAL_RX_BUFFER_SIZE;
+    
+    // Wait next frame
+    REG_USART3_CR = US_CR_STTTO;
+    REG_USART3_PTCR = US_PTCR_RXTEN;
 }
\ No newline at end of file
@@ -9,7 +9,7 @@
 #include <stdbool.h>
 
 
-#define USART3_USE_INTERNAL_BUFFER            (0x00000000)
+#define USART3_FRAME_BUFFER_SIZE              (1024)    // Wireless frame size
 
 
 void           usart3_init(uint32_t baud_rate);
@@ -19,12 +19,18 @@ bool           usart3_is_error(void);
 
 void           usart3_start_tx(uint32_t bytes_count);
 bool           usart3_is_tx_complete(void);
+bool           usart3_is_tx_buffer_free(void);
 uint8_t*       usart3_get_internal_tx_buffer_address(void);
 
-void           usart3_start_rx(uint8_t* external_rx_buffer, uint32_t external_buffer_size);
+void           usart3_start_rx(void);
 bool           usart3_is_frame_received(void);
 uint32_t       usart3_get_frame_size(void);
 const uint8_t* usart3_get_internal_rx_buffer_address(void);
+uint8_t*       usart3_get_internal_rx_buffer_address_for_tx(void);
+void           usart3_start_tx_from_rx_buffer(uint32_t bytes_count);
+void           usart3_release_frame(void);
+void           usart3_update_rx_crc(void);
+uint16_t       usart3_get_frame_crc(void);
 
 
 #endif // USART3_PDC_H_
\ No newline at end of file
@@ -0,0 +1,24 @@
+//  ***************************************************************************
+/// @file    boot.c
+/// @author  NeoProg
+//  ***************************************************************************
+#include "boot.h"
+
+#include <sam.h>
+#include "systimer.h"
+
+
+uint32_t boot_timeline[BOOT_STAGE_COUNT] = {0};     // Stage complete time from systimer start, us. 0 - stage is not complete
+
+
+//  ***************************************************************************
+/// @brief  Save boot stage complete time
+/// @param  stage: boot stage
+/// @return none
+//  ***************************************************************************
+void boot_mark_stage(boot_stage_t stage) {
+    
+    if (stage < BOOT_STAGE_COUNT && boot_timeline[stage] == 0) {
+        boot_timeline[stage] = get_time_us();
+    }
+}
@@ -0,0 +1,105 @@
+//  ***************************************************************************
+/// @file    bulk_transfer.c
+/// @author  NeoProg
+//  ***************************************************************************
+#include "bulk_transfer.h"
+
+#include <sam.h>
+#include <string.h>
+#include "veeprom.h"
+#include "ram_map.h"
+
+
+typedef struct {
+    uint32_t size;
+    bool (*read)(uint32_t offset, uint8_t* buffer, uint32_t size);
+} blob_info_t;
+
+
+static bool firmware_read(uint32_t offset, uint8_t* buffer, uint32_t size);
+static bool veeprom_read(uint32_t offset, uint8_t* buffer, uint32_t size);
+static bool ram_map_blob_read(uint32_t offset, uint8_t* buffer, uint32_t size);
+
+
+static const blob_info_t blob_registry[BULK_TRANSFER_BLOB_COUNT] = {
+    [BULK_TRANSFER_BLOB_FIRMWARE] = { .size = IFLASH0_SIZE,   .read = firmware_read     },
+    [BULK_TRANSFER_BLOB_VEEPROM]  = { .size = VEEPROM_SIZE,   .read = veeprom_read      },
+    [BULK_TRANSFER_BLOB_RAM_MAP]  = { .size = RAM_MAP_SIZE,   .read = ram_map_blob_read },
+};
+
+
+//  ***************************************************************************
+/// @brief  Get blob size
+/// @param  blob_id: blob ID
+/// @param  size: pointer to blob size
+/// @return true - success, false - blob not found
+//  ***************************************************************************
+bool bulk_transfer_get_blob_size(uint32_t blob_id, uint32_t* size) {
+    
+    if (blob_id >= BULK_TRANSFER_BLOB_COUNT) {
+        return false;
+    }
+    
+    *size = blob_registry[blob_id].size;
+    return true;
+}
+
+//  ***************************************************************************
+/// @brief  Read blob chunk
+/// @param  blob_id: blob ID
+/// @param  offset: chunk offset in blob
+/// @param  buffer: buffer for chunk
+/// @param  size: chunk size
+/// @return true - success, false - blob not found, chunk out of blob or read error
+//  ***************************************************************************
+bool bulk_transfer_read(uint32_t blob_id, uint32_t offset, uint8_t* buffer, uint32_t size) {
+    
+    if (blob_id >= BULK_TRANSFER_BLOB_COUNT) {
+        return false;
+    }
+    
+    const blob_info_t* blob = &blob_registry[blob_id];
+    if (offset >= blob->size || size > blob->size - offset) {
+        return false;
+    }
+    
+    return blob->read(offset, buffer, size);
+}
+
+
+
+
+
+//  ***************************************************************************
+/// @brief  Read firmware blob chunk
+/// @param  offset: chunk offset in blob
+/// @param  buffer: buffer for chunk
+/// @param  size: chunk size
+/// @return true - success, false - fail
+//  ***************************************************************************
+static bool firmware_read(uint32_t offset, uint8_t* buffer, uint32_t size) {
+    memcpy(buffer, (const uint8_t*)(IFLASH0_ADDR + offset), size);
+    return true;
+}
+
+//  ***************************************************************************
+/// @brief  Read VEEPROM blob chunk
+/// @param  offset: chunk offset in blob
+/// @param  buffer: buffer for chunk
+/// @param  size: chunk size
+/// @return true - success, false - fail
+//  ***************************************************************************
+static bool veeprom_read(uint32_t offset, uint8_t* buffer, uint32_t size) {
+    return veeprom_read_bytes(offset, buffer, size);
+}
+
+//  ***************************************************************************
+/// @brief  Read RAM map blob chunk
+/// @param  offset: chunk offset in blob
+/// @param  buffer: buffer for chunk
+/// @param  size: chunk size
+/// @return true - success, false - fail
+//  ***************************************************************************
+static bool ram_map_blob_read(uint32_t offset, uint8_t* buffer, uint32_t size) {
+    return ram_map_read(RAM_MAP_BEGIN_ADDRESS + offset, buffer, size);
+}
@@ -12,9 +12,11 @@
 
 #define LOW_BATTERY_VOLTAGE_BEEP_ENABLE_TIME        (150)    // ms
 #define LOW_BATTERY_VOLTAGE_BEEP_DISABLE_TIME       (500)    // ms
+#define STARTUP_BEEP_TIME                           (150)    // ms
 
 
 typedef enum {
+    BEEP_STATE_STARTUP_BEEP,
     BEEP_STATE_CHECK,
     BEEP_STATE_ENABLE,
     BEEP_STATE_ENABLE_DELAY,
@@ -23,9 +25,13 @@ typedef enum {
 } beep_state_t;
 
 
+static beep_state_t beep_state = BEEP_STATE_CHECK;
+static uint32_t prev_time = 0;
+
 
 //  ***************************************************************************
 /// @brief  Buzzer initialization
+/// @note   Startup beep is disabled by buzzer_process()
 /// @param  none
 /// @return none
 //  ***************************************************************************
@@ -33,8 +39,9 @@ void buzzer_init(void) {
     
     dac_init();
     dac_set_output_value(0, 4090);
-    delay_ms(LOW_BATTERY_VOLTAGE_BEEP_ENABLE_TIME);
-    dac_set_output_value(0, 0);
+    
+    prev_time = get_time_ms();
+    beep_state = BEEP_STATE_STARTUP_BEEP;
 }
 
 //  ***************************************************************************
@@ -44,12 +51,17 @@ void buzzer_init(void) {
 //  ***************************************************************************
 void buzzer_process(void) {
     
-    static beep_state_t beep_state = BEEP_STATE_CHECK;
-    static uint32_t prev_time = 0;
     static uint32_t beep_count = 0;
     
     switch (beep_state) {
         
+        case BEEP_STATE_STARTUP_BEEP:
+            if (get_time_ms() - prev_time > STARTUP_BEEP_TIME) {
+                dac_set_output_value(0, 0);
+                beep_state = BEEP_STATE_CHECK;
+            }
+            break;
+        
         case BEEP_STATE_CHECK:
             if (callback_is_voltage_error_set() == true) {
                 beep_state = BEEP_STATE_ENABLE;
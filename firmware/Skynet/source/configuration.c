@@ -0,0 +1,195 @@
+//  ***************************************************************************
+/// @file    configuration.c
+/// @author  NeoProg
+//  ***************************************************************************
+#include "configuration.h"
+
+#include <sam.h>
+#include <stddef.h>
+#include "veeprom.h"
+#include "veeprom_map.h"
+#include "crc32.h"
+
+#define CONFIGURATION_DATA_SIZE             (offsetof(configuration_t, version))
+#define CONFIGURATION_HEADER_NOT_WRITTEN    (0xFFFF)
+
+// Layout should match VEEPROM map
+_Static_assert(sizeof(limb_configuration_t) == LIMB_CONFIGURATION_SIZE, "Wrong limb configuration size");
+_Static_assert(offsetof(limb_configuration_t, link_length) == LIMB_COXA_LENGTH_EE_ADDRESS, "Wrong limb configuration layout");
+_Static_assert(offsetof(limb_configuration_t, link_zero_rotate) == LIMB_COXA_ZERO_ROTATE_EE_ADDRESS, "Wrong limb configuration layout");
+_Static_assert(offsetof(limb_configuration_t, link_angle_range) == LIMB_COXA_MIN_ANGLE_EE_ADDRESS, "Wrong limb configuration layout");
+_Static_assert(offsetof(limb_configuration_t, start_position) == LIMB_START_POSITION_X_EE_ADDRESS, "Wrong limb configuration layout");
+_Static_assert(sizeof(servo_configuration_t) == SERVO_CONFIGURATION_SIZE, "Wrong servo configuration size");
+_Static_assert(offsetof(servo_configuration_t, config) == SERVO_CONFIG_OFFSET, "Wrong servo configuration layout");
+_Static_assert(offsetof(servo_configuration_t, angle_correction) == SERVO_ANGLE_CORRECTION_OFFSET, "Wrong servo configuration layout");
+_Static_assert(offsetof(servo_configuration_t, max_physic_angle) == SERVO_MAX_PHYSIC_ANGLE_OFFSET, "Wrong servo configuration layout");
+_Static_assert(offsetof(servo_configuration_t, calibration_table) == SERVO_CALIBRATION_TABLE_OFFSET, "Wrong servo configuration layout");
+_Static_assert(sizeof(voltage_divisor_configuration_t) == VOLTAGE_DIVISOR_CONFIGURATION_SIZE, "Wrong voltage divisor configuration size");
+_Static_assert(offsetof(voltage_divisor_configuration_t, up_resist) == VOLTAGE_DIVISOR_UP_RESIST_OFFSET, "Wrong voltage divisor configuration layout");
+_Static_assert(offsetof(voltage_divisor_configuration_t, down_resist) == VOLTAGE_DIVISOR_DOWN_RESIST_OFFSET, "Wrong voltage divisor configuration layout");
+_Static_assert(offsetof(configuration_t, servos) == SERVO_CONFIGURATION_BASE_EE_ADDRESS, "Wrong configuration layout");
+_Static_assert(offsetof(configuration_t, voltage_divisors) == VOLTAGE_DIVISOR_CONFIGURATION_BASE_EE_ADDRESS, "Wrong configuration layout");
+_Static_assert(offsetof(configuration_t, battery_low_voltage_threshold) == BATTERY_LOW_VOLTAGE_THRESHOLD_EE_ADDRESS, "Wrong configuration layout");
+_Static_assert(offsetof(configuration_t, front_distance_low_limit) == FRONT_DISTANCE_LOW_LIMIT_EE_ADDRESS, "Wrong configuration layout");
+_Static_assert(sizeof(configuration_t) <= VEEPROM_SIZE, "Configuration does not fit to VEEPROM");
+
+
+static configuration_t configuration = {0};         // Decoded configuration (CPU byte order)
+static bool is_configuration_valid = false;
+
+
+static uint16_t swap_16(uint16_t value);
+static uint32_t swap_32(uint32_t value);
+static void decode_configuration(void);
+
+
+//  ***************************************************************************
+/// @brief  Read and decode configuration image
+/// @note   Image is read by one block. Call after veeprom_init()
+/// @param  none
+/// @return true - configuration valid, false - image version or CRC is wrong
+//  ***************************************************************************
+bool configuration_init(void) {
+    
+    is_configuration_valid = false;
+    veeprom_read_bytes(0, (uint8_t*)&configuration, sizeof(configuration));
+    
+    // Check image header. Image without header is accepted
+    uint16_t version = swap_16(configuration.version);
+    if (version != CONFIGURATION_HEADER_NOT_WRITTEN) {
+        
+        if (version != CONFIGURATION_VERSION || swap_16(configuration.size) != CONFIGURATION_DATA_SIZE) {
+            return false;
+        }
+        if (crc32_calculate((const uint8_t*)&configuration, CONFIGURATION_DATA_SIZE) != swap_32(configuration.crc)) {
+            return false;
+        }
+    }
+    
+    decode_configuration();
+    is_configuration_valid = true;
+    return true;
+}
+
+//  ***************************************************************************
+/// @brief  Write image header for current VEEPROM data
+/// @note   Header is committed to flash with VEEPROM checksum
+/// @param  none
+/// @return true - write success, false - fail
+//  ***************************************************************************
+bool configuration_update_header(void) {
+    
+    uint8_t data[CONFIGURATION_DATA_SIZE];
+    veeprom_read_bytes(0, data, sizeof(data));
+    
+    return veeprom_write_16(offsetof(configuration_t, version), CONFIGURATION_VERSION) &&
+           veeprom_write_16(offsetof(configuration_t, size), CONFIGURATION_DATA_SIZE) &&
+           veeprom_write_32(offsetof(configuration_t, crc), crc32_calculate(data, sizeof(data)));
+}
+
+//  ***************************************************************************
+/// @brief  Get configuration
+/// @return Pointer to configuration, NULL - configuration is not valid
+//  ***************************************************************************
+const configuration_t* configuration_get(void) {
+    
+    return is_configuration_valid ? &configuration : NULL;
+}
+
+//  ***************************************************************************
+/// @brief  Get limb configuration
+/// @param  index: limb index
+/// @return Pointer to configuration, NULL - configuration is not valid
+//  ***************************************************************************
+const limb_configuration_t* configuration_get_limb(uint32_t index) {
+    
+    if (is_configuration_valid == false || index >= CONFIGURATION_LIMB_SLOT_COUNT) {
+        return NULL;
+    }
+    return &configuration.limbs[index];
+}
+
+//  ***************************************************************************
+/// @brief  Get servo configuration
+/// @param  index: servo index
+/// @return Pointer to configuration, NULL - configuration is not valid
+//  ***************************************************************************
+const servo_configuration_t* configuration_get_servo(uint32_t index) {
+    
+    if (is_configuration_valid == false || index >= CONFIGURATION_SERVO_SLOT_COUNT) {
+        return NULL;
+    }
+    return &configuration.servos[index];
+}
+
+//  ***************************************************************************
+/// @brief  Get voltage divisor configuration
+/// @param  index: ADC channel index
+/// @return Pointer to configuration, NULL - configuration is not valid
+//  ***************************************************************************
+const voltage_divisor_configuration_t* configuration_get_voltage_divisor(uint32_t index) {
+    
+    if (is_configuration_valid == false || index >= CONFIGURATION_VOLTAGE_DIVISOR_SLOT_COUNT) {
+        return NULL;
+    }
+    return &configuration.voltage_divisors[index];
+}
+
+
+
+
+
+//  ***************************************************************************
+/// @brief  Swap bytes of word
+/// @param  value: word value
+/// @return Swapped value
+//  ***************************************************************************
+static uint16_t swap_16(uint16_t value) {
+    return (uint16_t)((value >> 8) | (value << 8));
+}
+
+//  ***************************************************************************
+/// @brief  Swap bytes of double word
+/// @param  value: double word value
+/// @return Swapped value
+//  ***************************************************************************
+static uint32_t swap_32(uint32_t value) {
+    return (value >> 24) | ((value >> 8) & 0x0000FF00) | ((value << 8) & 0x00FF0000) | (value << 24);
+}
+
+//  ***************************************************************************
+/// @brief  Convert image fields from VEEPROM byte order (MSB first)
+/// @param  none
+/// @return none
+//  ***************************************************************************
+static void decode_configuration(void) {
+    
+    for (uint32_t i = 0; i < CONFIGURATION_LIMB_SLOT_COUNT; ++i) {
+        
+        limb_configuration_t* limb = &configuration.limbs[i];
+        for (uint32_t link = 0; link < 3; ++link) {
+            limb->link_length[link] = swap_16(limb->link_length[link]);
+            limb->link_zero_rotate[link] = (int16_t)swap_16(limb->link_zero_rotate[link]);
+            limb->start_position[link] = (int16_t)swap_16(limb->start_position[link]);
+        }
+    }
+    
+    for (uint32_t i = 0; i < CONFIGURATION_SERVO_SLOT_COUNT; ++i) {
+        
+        servo_configuration_t* servo = &configuration.servos[i];
+        servo->max_physic_angle = swap_16(servo->max_physic_angle);
+        for (uint32_t point = 0; point < CONFIGURATION_CALIBRATION_TABLE_SIZE; ++point) {
+            servo->calibration_table[point] = swap_16(servo->calibration_table[point]);
+        }
+    }
+    
+    for (uint32_t i = 0; i < CONFIGURATION_VOLTAGE_DIVISOR_SLOT_COUNT; ++i) {
+        configuration.voltage_divisors[i].up_resist = swap_32(configuration.voltage_divisors[i].up_resist);
+        configuration.voltage_divisors[i].down_resist = swap_32(configuration.voltage_divisors[i].down_resist);
+    }
+    
+    configuration.front_distance_low_limit = swap_32(configuration.front_distance_low_limit);
+    configuration.version = swap_16(configuration.version);
+    configuration.size = swap_16(configuration.size);
+    configuration.crc = swap_32(configuration.crc);
+}
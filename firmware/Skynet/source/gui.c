@@ -12,8 +12,10 @@
 #include "systimer.h"
 #include "error_handling.h"
 #include "version.h"
+#include "boot.h"
 
 #define DISPLAY_UPDATE_PERIOD                   (500)
+#define LOGO_SHOW_TIME                          (1000)
 
 
 #define SKYNET_LOGO_BITMAP_WIDTH                (128)
@@ -147,6 +149,8 @@ static const uint8_t comm_bitmap[] = {
 
 typedef enum {
     STATE_NOINIT,
+    STATE_SHOW_LOGO,
+    STATE_DRAW_MAIN_SCREEN,
     STATE_UPDATE_BATTERY_VOLTAGE,
     STATE_UPDATE_PERIPHERY_VOLTAGE,
     STATE_UPDATE_WIRELESS_VOLTAGE,
@@ -156,6 +160,10 @@ typedef enum {
 } state_t;
 
 static state_t module_state = STATE_NOINIT;
+static uint32_t logo_show_time = 0;
+
+
+static void draw_main_screen(void);
 
 
 //  ***************************************************************************
@@ -169,54 +177,12 @@ void gui_init(void) {
         return;
     }
     
-    // Show logo
+    // Show logo. Main screen is drawn by gui_process() after LOGO_SHOW_TIME
     oled_gl_draw_bitmap(0, 0, SKYNET_LOGO_BITMAP_WIDTH, SKYNET_LOGO_BITMAP_HEIGHT, skynet_logo_bitmap);
-    oled_gl_display_update();
-    delay_ms(1000);
-    oled_gl_clear_display();
-    oled_gl_display_update();
-    
-
-    // Draw battery voltage
-    oled_gl_draw_bitmap(0, 0, BATTERY_BITMAP_WIDTH, BATTERY_BITMAP_HEIGHT, battery_bitmap);
-    oled_gl_draw_float_number(0, 20, 0.0);
-    oled_gl_draw_string(0, 45, "V");
-    
-    // Draw periphery voltage
-    oled_gl_draw_bitmap(2, 0, CHIP_BITMAP_WIDTH, CHIP_BITMAP_HEIGHT, chip_bitmap);
-    oled_gl_draw_float_number(2, 20, 0.0);
-    oled_gl_draw_string(2, 45, "V");
+    oled_gl_start_async_display_update();
+    logo_show_time = get_time_ms();
     
-    // Draw wireless voltage
-    oled_gl_draw_bitmap(4, 3, COMM_BITMAP_WIDTH, COMM_BITMAP_HEIGHT, comm_bitmap);
-    oled_gl_draw_float_number(4, 20, 0.0);
-    oled_gl_draw_string(4, 45, "V");
-    
-    // Draw horizontal separator
-    oled_gl_draw_horizontal_line(5, 0, 7, 128);
-    
-    // Draw error status
-    oled_gl_draw_hex_number(7, 0, 0x00000000);
-    
-    // Draw FW version number
-    oled_gl_draw_string(7, 72, VERSION_STR);
-    
-    // Draw vertical separator
-    oled_gl_draw_string(0, 56, "|");
-    oled_gl_draw_string(1, 56, "|");
-    oled_gl_draw_string(2, 56, "|");
-    oled_gl_draw_string(3, 56, "|");
-    oled_gl_draw_string(4, 56, "|");
-    
-    // Draw system mode
-    oled_gl_draw_string(0, 67, "SYSTEM");
-    oled_gl_draw_string(2, 67, "INITIALIZE");
-    oled_gl_draw_string(4, 67, "MODE");
-    
-    oled_gl_display_update();
-    
-    
-    module_state = STATE_UPDATE_BATTERY_VOLTAGE;
+    module_state = STATE_SHOW_LOGO;
 }
 
 //  ***************************************************************************
@@ -233,18 +199,31 @@ void gui_process(void) {
     
     switch (module_state) {
         
+        case STATE_SHOW_LOGO:
+            if (get_time_ms() - logo_show_time >= LOGO_SHOW_TIME && oled_gl_is_async_display_update_complete() == true) {
+                module_state = STATE_DRAW_MAIN_SCREEN;
+            }
+            break;
+            
+        case STATE_DRAW_MAIN_SCREEN:
+            draw_main_screen();
+            oled_gl_start_async_display_update();
+            boot_mark_stage(BOOT_STAGE_DISPLAY);
+            module_state = STATE_UPDATE_BATTERY_VOLTAGE;
+            break;
+        
         case STATE_UPDATE_BATTERY_VOLTAGE:
-            oled_gl_draw_float_number(0, 20, battery_voltage / 10.0);
+            oled_gl_draw_fixed_number(0, 20, battery_voltage, 1, 4);
             module_state = STATE_UPDATE_PERIPHERY_VOLTAGE;
             break;
         
         case STATE_UPDATE_PERIPHERY_VOLTAGE:
-            oled_gl_draw_float_number(2, 20, sensors_voltage / 10.0);
+            oled_gl_draw_fixed_number(2, 20, sensors_voltage, 1, 4);
             module_state = STATE_UPDATE_WIRELESS_VOLTAGE;
             break;
             
         case STATE_UPDATE_WIRELESS_VOLTAGE:
-            oled_gl_draw_float_number(4, 20, wireless_voltage / 10.0);
+            oled_gl_draw_fixed_number(4, 20, wireless_voltage, 1, 4);
             module_state = STATE_UPDATE_ERROR_STATUS;
             break;
             
@@ -271,7 +250,7 @@ void gui_process(void) {
             break;
             
         case STATE_UPDATE_DISPLAY:
-            if (get_time_ms() - prev_update_time >= DISPLAY_UPDATE_PERIOD) {
+            if (get_time_ms() - prev_update_time >= DISPLAY_UPDATE_PERIOD && oled_gl_is_async_display_update_complete() == true) {
                 
                 static bool is_rect_visible = false;
                 if (is_rect_visible == true) {
@@ -297,4 +276,54 @@ void gui_process(void) {
     
     
     oled_gl_async_display_update_process();
+}
+
+
+
+
+
+//  ***************************************************************************
+/// @brief  Draw main screen layout
+/// @param  none
+/// @return none
+//  ***************************************************************************
+static void draw_main_screen(void) {
+    
+    oled_gl_clear_display();
+    
+    // Draw battery voltage
+    oled_gl_draw_bitmap(0, 0, BATTERY_BITMAP_WIDTH, BATTERY_BITMAP_HEIGHT, battery_bitmap);
+    oled_gl_draw_fixed_number(0, 20, 0, 1, 4);
+    oled_gl_draw_string(0, 45, "V");
+    
+    // Draw periphery voltage
+    oled_gl_draw_bitmap(2, 0, CHIP_BITMAP_WIDTH, CHIP_BITMAP_HEIGHT, chip_bitmap);
+    oled_gl_draw_fixed_number(2, 20, 0, 1, 4);
+    oled_gl_draw_string(2, 45, "V");
+    
+    // Draw wireless voltage
+    oled_gl_draw_bitmap(4, 3, COMM_BITMAP_WIDTH, COMM_BITMAP_HEIGHT, comm_bitmap);
+    oled_gl_draw_fixed_number(4, 20, 0, 1, 4);
+    oled_gl_draw_string(4, 45, "V");
+    
+    // Draw horizontal separator
+    oled_gl_draw_horizontal_line(5, 0, 7, 128);
+    
+    // Draw error status
+    oled_gl_draw_hex_number(7, 0, 0x00000000);
+    
+    // Draw FW version number
+    oled_gl_draw_string(7, 72, VERSION_STR);
+    
+    // Draw vertical separator
+    oled_gl_draw_string(0, 56, "|");
+    oled_gl_draw_string(1, 56, "|");
+    oled_gl_draw_string(2, 56, "|");
+    oled_gl_draw_string(3, 56, "|");
+    oled_gl_draw_string(4, 56, "|");
+    
+    // Draw system mode
+    oled_gl_draw_string(0, 67, "SYSTEM");
+    oled_gl_draw_string(2, 67, "INITIALIZE");
+    oled_gl_draw_string(4, 67, "MODE");
 }
\ No newline at end of file
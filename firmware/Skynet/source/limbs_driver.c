@@ -7,8 +7,7 @@
 #include <sam.h>
 #include <fastmath.h>
 #include "servo_driver.h"
-#include "veeprom.h"
-#include "veeprom_map.h"
+#include "configuration.h"
 #include "systimer.h"
 #include "pwm.h"
 #include "error_handling.h"
@@ -273,48 +272,32 @@ static bool read_configuration(void) {
     
     for (uint32_t i = 0; i < SUPPORT_LIMB_COUNT; ++i) {
         
-        uint32_t base_address = i * LIMB_CONFIGURATION_SIZE;
-        
-        // Read coxa, femur and tibia lengths
-        limbs[i].links[LINK_COXA].length = (uint16_t)veeprom_read_16(base_address + LIMB_COXA_LENGTH_EE_ADDRESS);
-        if (limbs[i].links[LINK_COXA].length == 0xFFFF) {
-            return false;
-        }
-        limbs[i].links[LINK_FEMUR].length = (uint16_t)veeprom_read_16(base_address + LIMB_FEMUR_LENGTH_EE_ADDRESS);
-        if (limbs[i].links[LINK_FEMUR].length == 0xFFFF) {
-            return false;
-        }
-        limbs[i].links[LINK_TIBIA].length = (uint16_t)veeprom_read_16(base_address + LIMB_TIBIA_LENGTH_EE_ADDRESS);
-        if (limbs[i].links[LINK_TIBIA].length == 0xFFFF) {
+        const limb_configuration_t* config = configuration_get_limb(i);
+        if (config == NULL) {
             return false;
         }
         
-        // Read coxa, femur and tibia zero rotate
-        limbs[i].links[LINK_COXA].zero_rotate = (int16_t)veeprom_read_16(base_address + LIMB_COXA_ZERO_ROTATE_EE_ADDRESS);
-        if (limbs[i].links[LINK_COXA].zero_rotate < -360 || limbs[i].links[LINK_COXA].zero_rotate > 360) {
-            return false;
-        }
-        limbs[i].links[LINK_FEMUR].zero_rotate = (int16_t)veeprom_read_16(base_address + LIMB_FEMUR_ZERO_ROTATE_EE_ADDRESS);
-        if (limbs[i].links[LINK_FEMUR].zero_rotate < -360 || limbs[i].links[LINK_FEMUR].zero_rotate > 360) {
-            return false;
-        }
-        limbs[i].links[LINK_TIBIA].zero_rotate = (int16_t)veeprom_read_16(base_address + LIMB_TIBIA_ZERO_ROTATE_EE_ADDRESS);
-        if (limbs[i].links[LINK_TIBIA].zero_rotate < -360 || limbs[i].links[LINK_TIBIA].zero_rotate > 360) {
-            return false;
+        for (uint32_t link = 0; link < 3; ++link) { // Coxa, femur and tibia
+            
+            // Lengths and zero rotate
+            limbs[i].links[link].length = config->link_length[link];
+            if (limbs[i].links[link].length == 0xFFFF) {
+                return false;
+            }
+            limbs[i].links[link].zero_rotate = config->link_zero_rotate[link];
+            if (limbs[i].links[link].zero_rotate < -360 || limbs[i].links[link].zero_rotate > 360) {
+                return false;
+            }
+            
+            // Angle ranges
+            limbs[i].links[link].min_angle = config->link_angle_range[link][0];
+            limbs[i].links[link].max_angle = config->link_angle_range[link][1];
         }
         
-        // Read coxa, femur and tibia angle ranges
-        limbs[i].links[LINK_COXA].min_angle  = (int8_t)veeprom_read_8(base_address + LIMB_COXA_MIN_ANGLE_EE_ADDRESS);
-        limbs[i].links[LINK_COXA].max_angle  = (int8_t)veeprom_read_8(base_address + LIMB_COXA_MAX_ANGLE_EE_ADDRESS);
-        limbs[i].links[LINK_FEMUR].min_angle = (int8_t)veeprom_read_8(base_address + LIMB_FEMUR_MIN_ANGLE_EE_ADDRESS);
-        limbs[i].links[LINK_FEMUR].max_angle = (int8_t)veeprom_read_8(base_address + LIMB_FEMUR_MAX_ANGLE_EE_ADDRESS);
-        limbs[i].links[LINK_TIBIA].min_angle = (int8_t)veeprom_read_8(base_address + LIMB_TIBIA_MIN_ANGLE_EE_ADDRESS);
-        limbs[i].links[LINK_TIBIA].max_angle = (int8_t)veeprom_read_8(base_address + LIMB_TIBIA_MAX_ANGLE_EE_ADDRESS);
-        
-        // Read coxa, femur and tibia start position
-        limbs[i].position.x = (int16_t)veeprom_read_16(base_address + LIMB_START_POSITION_X_EE_ADDRESS);
-        limbs[i].position.y = (int16_t)veeprom_read_16(base_address + LIMB_START_POSITION_Y_EE_ADDRESS);
-        limbs[i].position.z = (int16_t)veeprom_read_16(base_address + LIMB_START_POSITION_Z_EE_ADDRESS);
+        // Start position
+        limbs[i].position.x = config->start_position[0];
+        limbs[i].position.y = config->start_position[1];
+        limbs[i].position.z = config->start_position[2];
     }
 
     return true;
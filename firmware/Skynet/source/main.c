@@ -11,14 +11,18 @@
 #include "monitoring.h"
 #include "orientation.h"
 #include "veeprom.h"
+#include "configuration.h"
+#include "transport.h"
 #include "modbus.h"
 #include "scr.h"
+#include "ram_map.h"
 #include "led.h"
 #include "i2c.h"
 #include "gui.h"
 #include "buzzer.h"
 #include "systimer.h"
 #include "error_handling.h"
+#include "boot.h"
 
 
 static void enter_to_emergency_loop(void);
@@ -43,21 +47,33 @@ int main(void) {
     REG_PIOC_CODR = PIO_PC22 | PIO_PC21 | PIO_PC29;*/
     
 
-    // Initialize FW
+    // Initialize FW. Initialization does not wait devices: display transfer
+    // and startup beep are completed by process functions in main loop
     systimer_init();
     led_init();
     i2c_init(I2C_SPEED_400KHZ);
+    boot_mark_stage(BOOT_STAGE_PERIPHERY);
+    
     gui_init();
+    boot_mark_stage(BOOT_STAGE_GUI);
+    
     veeprom_init();
+    configuration_init();
+    boot_mark_stage(BOOT_STAGE_MEMORY);
+    
+    transport_init();
     modbus_init();
+    boot_mark_stage(BOOT_STAGE_COMMUNICATION);
+    
     monitoring_init();
     orientation_init();
+    boot_mark_stage(BOOT_STAGE_SENSORS);
     
     servo_driver_init();
     limbs_driver_init();
     movement_engine_init();
-    
     buzzer_init();
+    boot_mark_stage(BOOT_STAGE_SERVO);
     
     while (1)  {
         
@@ -78,16 +94,22 @@ int main(void) {
         gui_process();
         led_process();
         buzzer_process();
+        i2c_process();
         
         servo_driver_process();
+        ram_map_process();
         limbs_driver_process();
         movement_engine_process();
         
-        modbus_process();
+        transport_process();
         scr_process();
+        modbus_process();
+        veeprom_process();
         
         monitoring_process();
         orientation_process();
+        
+        boot_mark_stage(BOOT_STAGE_READY); // Saved once: after first main loop pass
     }
 }
 
@@ -102,9 +124,13 @@ static void enter_to_emergency_loop(void) {
         
         gui_process();
         led_process();
+        buzzer_process();
+        i2c_process();
         
-        modbus_process();
+        transport_process();
         scr_process();
+        modbus_process();
+        veeprom_process();
         
         monitoring_process();
     }
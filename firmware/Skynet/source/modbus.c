@@ -7,30 +7,44 @@
 #include <sam.h>
 #include <string.h>
 #include "ram_map.h"
+#include "crc16.h"
 #include "veeprom.h"
 #include "usart0_pdc.h"
-#include "usart3_pdc.h"
+#include "systimer.h"
 
-#define SUPPORT_USART_COUNT                     (2)
-#define USART_BAUD_RATE                         (115200)
 
-#define CRC16_POLYNOM                           (0xA001)    // CRC polynom
+#define MB_MAX_FRAME_SIZE                       (USART0_FRAME_BUFFER_SIZE)
 
 #define MB_MIN_REQUEST_SIZE                     (7)
 #define MB_READ_RAM_CMD_MIN_LENGTH              (7)
+#define MB_READ_RAM_MULTIPLE_CMD_MIN_LENGTH     (8)
 #define MB_WRITE_RAM_CMD_MIN_LENGTH             (8)
 #define MB_READ_EEPROM_CMD_MIN_LENGTH           (7)
 #define MB_WRITE_EEPROM_CMD_MIN_LENGTH          (8)
+#define MB_SET_BAUD_RATE_CMD_LENGTH             (8)
+#define MB_BEGIN_EEPROM_TRANSACTION_CMD_LENGTH  (8)
+#define MB_WRITE_EEPROM_CHUNK_CMD_MIN_LENGTH    (8)
+#define MB_COMMIT_EEPROM_TRANSACTION_CMD_LENGTH (8)
 
 #define MAX_READ_RAM_SIZE                       (32)
 #define MAX_WRITE_RAM_SIZE                      (32)
 #define MAX_READ_EEPROM_SIZE                    (32)
 #define MAX_WRITE_EEPROM_SIZE                   (16)
+#define MAX_READ_RAM_MULTIPLE_SIZE              (MB_MAX_FRAME_SIZE - 5)   // 5: address, function code, bytes count, CRC
+#define MAX_EEPROM_CHUNK_SIZE                   (MB_MAX_FRAME_SIZE - 7)   // 7: address, function code, offset, bytes count, CRC
+#define MAX_EEPROM_TRANSACTION_SIZE             (VEEPROM_SIZE)            // Full configuration image. Can't be staged in VEEPROM shadow: it is flushed in background
+#define EEPROM_COMMIT_TIMEOUT                   (1500)                    // Time for store transaction data to flash, ms. Host waits 2000 ms
 
 #define MB_CMD_WRITE_RAM                        (0x41) // ModBus Function Code: Write RAM
 #define MB_CMD_WRITE_EEPROM                     (0x43) // ModBus Function Code: Write EEPROM
 #define MB_CMD_READ_RAM                         (0x44) // ModBus Function Code: Read RAM
 #define MB_CMD_READ_EEPROM                      (0x46) // ModBus Function Code: Read EEPROM
+#define MB_CMD_READ_RAM_MULTIPLE                (0x47) // ModBus Function Code: Read several RAM ranges
+#define MB_CMD_TELEMETRY                        (0x48) // ModBus Function Code: Telemetry frame (sent by device without request)
+#define MB_CMD_SET_BAUD_RATE                    (0x49) // ModBus Function Code: Set baud rate (applied after response)
+#define MB_CMD_BEGIN_EEPROM_TRANSACTION         (0x4A) // ModBus Function Code: Begin EEPROM write transaction
+#define MB_CMD_WRITE_EEPROM_CHUNK               (0x4B) // ModBus Function Code: Write chunk of EEPROM write transaction
+#define MB_CMD_COMMIT_EEPROM_TRANSACTION        (0x4C) // ModBus Function Code: Check and commit EEPROM write transaction
 
 #define MB_OK                                   (0x00)
 #define MB_EXCEPTION_ILLEGAL_FUNCTION           (0x01) // ModBus Exception code: Illegal Function. Requested Function is not supported, or is not supported in current Device mode.
@@ -38,59 +52,91 @@
 #define MB_EXCEPTION_ILLEGAL_DATA_VALUE         (0x03) // ModBus Exception code: Illegal Data Value. Requested amount of Data is out of range.
 #define MB_EXCEPTION_SLAVE_DEV_FAILURE          (0x04) // ModBus Exception code: Slave Device Failure. Device can't execute incoming command (EEPROM failure, insufficient RAM, etc).
 #define MB_BAD_FRAME                            (0xFF)
+#define MB_JOB_IN_PROGRESS                      (0xFE) // Request is executing by background job
 
+#define TELEMETRY_MIN_PERIOD                    (10)   // Minimum period between telemetry frames, ms
+
+#define MIN_BAUD_RATE                           (9600)
+#define MAX_BAUD_RATE                           (2000000)
+#define BAUD_RATE_FALLBACK_TIMEOUT              (2000) // Time without valid requests before return to default baud rate, ms
+
+
+typedef struct {
+    
+    uint32_t baud_rate;
+    uint32_t next_baud_rate;        // Baud rate for switch after response transmit. 0 - no switch
+    uint32_t last_request_time;
+    
+} port_state_t;
+
+typedef enum {
+    EEPROM_JOB_IDLE,
+    EEPROM_JOB_PENDING,
+    EEPROM_JOB_DONE
+} eeprom_job_state_t;
+
+typedef struct {
+    
+    eeprom_job_state_t state;
+    uint32_t port;
+    uint8_t  function_code;         // Request function code: write EEPROM or commit transaction
+    uint16_t address;
+    uint8_t  bytes_count;
+    uint8_t  data[MAX_WRITE_EEPROM_SIZE];
+    uint32_t result;
+    bool     is_flush_started;      // Transaction data is written to VEEPROM, wait flash program complete
+    uint32_t flush_start_time;
+    
+} eeprom_job_t;
 
 typedef struct {
     
-    void(*usart_init)(uint32_t baud_rate);
-    void(*usart_reset)(bool is_reset_transmitter, bool is_reset_receiver);
-    bool(*usart_is_error)(void);
-    void(*usart_start_tx)(uint32_t bytes_count);
-    bool(*usart_is_tx_complete)(void);
-    uint8_t*(*usart_get_internal_tx_buffer_address)(void);
-    void(*usart_start_rx)(uint8_t* external_rx_buffer, uint32_t external_buffer_size);
-    bool(*usart_is_frame_received)(void);
-    uint32_t(*usart_get_frame_size)(void);
-    const uint8_t*(*usart_get_internal_rx_buffer_address)(void);
-    
-} usart_info_t;
-
-
-static const usart_info_t usarts[SUPPORT_USART_COUNT] = {
-    
-    {
-        .usart_init = usart0_init,
-        .usart_reset = usart0_reset,
-        .usart_is_error = usart0_is_error,
-        .usart_start_tx = usart0_start_tx,
-        .usart_is_tx_complete = usart0_is_tx_complete,
-        .usart_get_internal_tx_buffer_address = usart0_get_internal_tx_buffer_address,
-        .usart_start_rx = usart0_start_rx,
-        .usart_is_frame_received = usart0_is_frame_received,
-        .usart_get_frame_size = usart0_get_frame_size,
-        .usart_get_internal_rx_buffer_address = usart0_get_internal_rx_buffer_address
-    },
-    {
-        .usart_init = usart3_init,
-        .usart_reset = usart3_reset,
-        .usart_is_error = usart3_is_error,
-        .usart_start_tx = usart3_start_tx,
-        .usart_is_tx_complete = usart3_is_tx_complete,
-        .usart_get_internal_tx_buffer_address = usart3_get_internal_tx_buffer_address,
-        .usart_start_rx = usart3_start_rx,
-        .usart_is_frame_received = usart3_is_frame_received,
-        .usart_get_frame_size = usart3_get_frame_size,
-        .usart_get_internal_rx_buffer_address = usart3_get_internal_rx_buffer_address
-    }
-};
-
-
-static bool     is_request_valid(const uint8_t* request, uint32_t size);
+    bool     is_active;
+    uint32_t port;
+    uint16_t address;               // VEEPROM address of transaction data
+    uint16_t size;
+    uint16_t received_size;         // Chunks are received sequentially, repeated chunk is accepted
+    
+} eeprom_transaction_t;
+
+typedef struct {
+    
+    uint8_t  port;                  // TELEMETRY_PORT_xxx
+    uint16_t period;
+    uint8_t  range_count;
+    uint8_t  range_list[TELEMETRY_MAX_RANGE_COUNT * RAM_MAP_RANGE_DESCRIPTOR_SIZE];
+    
+} telemetry_subscription_t;
+
+
+static port_state_t ports[TRANSPORT_PORT_COUNT] = {0};
+static eeprom_job_t eeprom_job = {0};
+static eeprom_transaction_t eeprom_transaction = {0};
+static uint8_t eeprom_staging_buffer[MAX_EEPROM_TRANSACTION_SIZE] = {0};   // Transaction data. Written to VEEPROM on commit only
+
+
+uint8_t  telemetry_port = TELEMETRY_PORT_DISABLED;
+uint16_t telemetry_period = 0;
+uint8_t  telemetry_range_count = 0;
+uint8_t  telemetry_range_list[TELEMETRY_MAX_RANGE_COUNT * RAM_MAP_RANGE_DESCRIPTOR_SIZE] = {0};
+
+static telemetry_subscription_t telemetry = {0};     // Active subscription
+
+
+static void     baud_rate_process(uint32_t port);
+static void     eeprom_job_process(void);
+static void     telemetry_process(void);
 static uint32_t read_ram_command_handler(const uint8_t* request, uint8_t* response, uint16_t rq_size, uint8_t* rs_size);
 static uint32_t write_ram_command_handler(const uint8_t* request, uint16_t rq_size);
+static uint32_t read_ram_multiple_command_handler(const uint8_t* request, uint8_t* response, uint16_t rq_size, uint8_t* rs_size);
 static uint32_t read_eeprom_command_handler(const uint8_t* request, uint8_t* response, uint8_t rq_size, uint8_t* rs_size);
-static uint32_t write_eeprom_command_handler(const uint8_t* request, uint16_t rq_size);
-static uint16_t calculate_crc16(const uint8_t* data, uint32_t size);
+static uint32_t write_eeprom_command_handler(uint32_t port, const uint8_t* request, uint16_t rq_size);
+static uint32_t set_baud_rate_command_handler(const uint8_t* request, uint16_t rq_size, uint32_t* baud_rate);
+static uint32_t begin_eeprom_transaction_command_handler(uint32_t port, const uint8_t* request, uint8_t* response, uint16_t rq_size, uint8_t* rs_size);
+static uint32_t write_eeprom_chunk_command_handler(uint32_t port, const uint8_t* request, uint16_t rq_size);
+static uint32_t commit_eeprom_transaction_command_handler(uint32_t port, const uint8_t* request, uint16_t rq_size);
+static uint32_t start_eeprom_job(uint32_t port, const uint8_t* request, uint16_t address, uint8_t bytes_count, const uint8_t* data);
+static uint32_t commit_eeprom_transaction(void);
 
 
 //  ***************************************************************************
@@ -101,9 +147,9 @@ static uint16_t calculate_crc16(const uint8_t* data, uint32_t size);
 //  ***************************************************************************
 void modbus_init(void) {
     
-    for (uint32_t i = 0; i < SUPPORT_USART_COUNT; ++i) {
-        usarts[i].usart_init(USART_BAUD_RATE);
-        usarts[i].usart_start_rx(USART0_USE_INTERNAL_BUFFER, 0);
+    for (uint32_t i = 0; i < TRANSPORT_PORT_COUNT; ++i) {
+        ports[i].baud_rate = TRANSPORT_DEFAULT_BAUD_RATE;
+        ports[i].next_baud_rate = 0;
     }
 }
 
@@ -113,94 +159,204 @@ void modbus_init(void) {
 //  ***************************************************************************
 void modbus_process(void) {
     
-    for (uint32_t i = 0; i < SUPPORT_USART_COUNT; ++i) {
+    for (uint32_t i = 0; i < TRANSPORT_PORT_COUNT; ++i) {
+        baud_rate_process(i);
+    }
     
-        // Check USART errors
-        if (usarts[i].usart_is_error() == true) {
-            usarts[i].usart_reset(true, true);
-            usarts[i].usart_start_rx(USART0_USE_INTERNAL_BUFFER, 0);
-            continue;
-        }
+    eeprom_job_process();
+    telemetry_process();
+}
+
+//  ***************************************************************************
+/// @brief  Apply telemetry subscription
+/// @note   RAM map callback for write to telemetry port register. Period
+///         and range list can be written before by separate requests
+/// @param  none
+/// @return true - subscription applied, false - subscription is invalid (previous subscription stays active)
+//  ***************************************************************************
+bool modbus_apply_telemetry_subscription(void) {
     
-        // Check frame received
-        if (usarts[i].usart_is_frame_received() == false) {
-            continue;
+    if (telemetry_port != TELEMETRY_PORT_DISABLED) {
+        
+        // Check subscription registers
+        uint8_t buffer[MAX_READ_RAM_MULTIPLE_SIZE];
+        uint32_t bytes_count = 0;
+        if (telemetry_port > TRANSPORT_PORT_COUNT || telemetry_period == 0 ||
+            telemetry_range_count == 0 || telemetry_range_count > TELEMETRY_MAX_RANGE_COUNT ||
+            ram_map_read_multiple(telemetry_range_list, telemetry_range_count, buffer, sizeof(buffer), &bytes_count) == false) {
+            
+            telemetry_port = telemetry.port;
+            return false;
         }
+    }
     
-        // Check complete transmit response
-        if (usarts[i].usart_is_tx_complete() == false) {
-            usarts[i].usart_start_rx(USART0_USE_INTERNAL_BUFFER, 0);
-            continue;
-        }
+    telemetry.port = telemetry_port;
+    telemetry.period = (telemetry_period < TELEMETRY_MIN_PERIOD) ? TELEMETRY_MIN_PERIOD : telemetry_period;
+    telemetry.range_count = telemetry_range_count;
+    memcpy(telemetry.range_list, telemetry_range_list, sizeof(telemetry.range_list));
+    return true;
+}
+
+//  ***************************************************************************
+/// @brief  Get ModBus request priority
+/// @param  request: ModBus request
+/// @param  size:  frame size
+/// @return request priority
+//  ***************************************************************************
+transport_priority_t modbus_get_frame_priority(const uint8_t* request, uint32_t size) {
     
-        // Verify frame
-        const uint8_t* request = usarts[i].usart_get_internal_rx_buffer_address();
-        uint32_t request_size = usarts[i].usart_get_frame_size();
-        if (is_request_valid(request, request_size) == false) {
-            usarts[i].usart_start_rx(USART0_USE_INTERNAL_BUFFER, 0);
-            continue;
-        }
+    if (size < 2) { // 2: address, function code
+        return TRANSPORT_PRIORITY_READ;
+    }
     
-        // Process command
-        uint8_t* response = usarts[i].usart_get_internal_tx_buffer_address();
-        uint8_t response_size = 0;
-        uint32_t result = MB_OK;
-
-        switch (request[1]) {
+    switch (request[1]) {
         
-            case MB_CMD_READ_RAM:
-                result = read_ram_command_handler(request, response, request_size, &response_size);
-                break;
+        case MB_CMD_WRITE_RAM:
+            return TRANSPORT_PRIORITY_CONTROL;
+        
+        case MB_CMD_READ_EEPROM:
+        case MB_CMD_WRITE_EEPROM:
+        case MB_CMD_BEGIN_EEPROM_TRANSACTION:
+        case MB_CMD_WRITE_EEPROM_CHUNK:
+        case MB_CMD_COMMIT_EEPROM_TRANSACTION:
+            return TRANSPORT_PRIORITY_BULK;
+        
+        default:
+            return TRANSPORT_PRIORITY_READ;
+    }
+}
 
-            case MB_CMD_WRITE_RAM:
-                result = write_ram_command_handler(request, request_size);
-                break;
+//  ***************************************************************************
+/// @brief  Check ModBus frame
+/// @param  request: ModBus request
+/// @param  size:  frame size
+/// @param  crc: CRC16 of frame
+/// @return true - frame valid, false - frame invalid
+//  ***************************************************************************
+bool modbus_is_frame_detected(const uint8_t* request, uint32_t size, uint16_t crc) {
+    
+    // Check frame size
+    if (size < MB_MIN_REQUEST_SIZE) {
+        return false;
+    }
+    
+    // Check device address
+    if (request[0] != 0xFE && request[0] != 0x68) {
+        return false;
+    }
+    
+    // Check CRC
+    if (crc != 0) {
+        return false;
+    }
+    
+    return true;
+}
+
+//  ***************************************************************************
+/// @brief  Process ModBus request
+/// @param  port: transport port index
+/// @param  request: ModBus request
+/// @param  request_size: request size
+/// @return TRANSPORT_FRAME_WAIT - TX buffer for response is busy, TRANSPORT_FRAME_PROCESSED - request processed
+//  ***************************************************************************
+transport_result_t modbus_process_frame(uint32_t port, const uint8_t* request, uint32_t request_size) {
+    
+    // Check TX buffer for response is free. Request stays in RX buffer until previous frames are transmitted
+    if (transport_is_tx_buffer_free(port) == false) {
+        return TRANSPORT_FRAME_WAIT;
+    }
+    ports[port].last_request_time = get_time_ms();
+    
+    // Process command
+    uint8_t* response = transport_get_tx_buffer(port);
+    uint8_t response_size = 0;
+    uint32_t result = MB_OK;
+
+    switch (request[1]) {
         
-            case MB_CMD_READ_EEPROM:
-                result = read_eeprom_command_handler(request, response, request_size, &response_size);
-                break;
+        case MB_CMD_READ_RAM:
+            result = read_ram_command_handler(request, response, request_size, &response_size);
+            break;
 
-            case MB_CMD_WRITE_EEPROM:
-                result = write_eeprom_command_handler(request, request_size);
+        case MB_CMD_WRITE_RAM:
+            result = write_ram_command_handler(request, request_size);
+            break;
+            
+        case MB_CMD_READ_RAM_MULTIPLE:
+            result = read_ram_multiple_command_handler(request, response, request_size, &response_size);
+            break;
+        
+        case MB_CMD_READ_EEPROM:
+            result = read_eeprom_command_handler(request, response, request_size, &response_size);
+            break;
+
+        case MB_CMD_WRITE_EEPROM:
+            result = write_eeprom_command_handler(port, request, request_size);
+            if (result == MB_JOB_IN_PROGRESS) {
+                return TRANSPORT_FRAME_WAIT;
+            }
+            break;
+            
+        case MB_CMD_SET_BAUD_RATE:
+            if (transport_is_baud_rate_switch_allowed(port) == false) {
+                result = MB_EXCEPTION_ILLEGAL_FUNCTION;
                 break;
+            }
+            result = set_baud_rate_command_handler(request, request_size, &ports[port].next_baud_rate);
+            break;
+            
+        case MB_CMD_BEGIN_EEPROM_TRANSACTION:
+            result = begin_eeprom_transaction_command_handler(port, request, response, request_size, &response_size);
+            break;
+            
+        case MB_CMD_WRITE_EEPROM_CHUNK:
+            result = write_eeprom_chunk_command_handler(port, request, request_size);
+            break;
+            
+        case MB_CMD_COMMIT_EEPROM_TRANSACTION:
+            result = commit_eeprom_transaction_command_handler(port, request, request_size);
+            if (result == MB_JOB_IN_PROGRESS) {
+                return TRANSPORT_FRAME_WAIT;
+            }
+            break;
 
-            default:
-                usarts[i].usart_start_rx(USART0_USE_INTERNAL_BUFFER, 0);
-                continue;
-        }
+        default:
+            return TRANSPORT_FRAME_PROCESSED;
+    }
     
-        // Check result
-        if (result != MB_OK) {
+    // Check result
+    if (result != MB_OK) {
         
-            if (result != MB_BAD_FRAME) {
+        if (result != MB_BAD_FRAME) {
             
-                // Make and send exception
-                response[1] = request[0] | 0x80;
-                response[2] = result;
+            // Make and send exception
+            response[0] = request[0];
+            response[1] = request[1] | 0x80;
+            response[2] = result;
+            response_size = 3;
             
-                uint16_t crc = calculate_crc16(response, response_size);
-                response[response_size++] = crc & 0xFF;
-                response[response_size++] = crc >> 8;
+            uint16_t crc = crc16_calculate(response, response_size);
+            response[response_size++] = crc & 0xFF;
+            response[response_size++] = crc >> 8;
             
-                usarts[i].usart_start_tx(response_size);
-                usarts[i].usart_start_rx(USART0_USE_INTERNAL_BUFFER, 0);
-            }
-            continue;
+            transport_start_tx(port, response_size);
         }
+        return TRANSPORT_FRAME_PROCESSED;
+    }
     
-        // Make response
-        response[0] = request[0];
-        response[1] = request[1];
-        response_size += 2;
+    // Make response
+    response[0] = request[0];
+    response[1] = request[1];
+    response_size += 2;
     
-        uint16_t crc = calculate_crc16(response, response_size);
-        response[response_size++] = crc & 0xFF;
-        response[response_size++] = crc >> 8;
+    uint16_t crc = crc16_calculate(response, response_size);
+    response[response_size++] = crc & 0xFF;
+    response[response_size++] = crc >> 8;
     
-        // Send response
-        usarts[i].usart_start_tx(response_size);
-        usarts[i].usart_start_rx(USART0_USE_INTERNAL_BUFFER, 0);
-    }
+    // Send response
+    transport_start_tx(port, response_size);
+    return TRANSPORT_FRAME_PROCESSED;
 }
 
 
@@ -208,30 +364,110 @@ void modbus_process(void) {
 
 
 //  ***************************************************************************
-/// @brief  Check ModBus frame
-/// @param  request: ModBus request
-/// @param  size:  frame size
-/// @return true - frame valid, false - frame invalid
+/// @brief  Baud rate process
+/// @note   New baud rate is applied after response transmit. Port returns to
+///         default baud rate if no valid requests are received during timeout
+/// @param  port: port index
+/// @return none
 //  ***************************************************************************
-static bool is_request_valid(const uint8_t* request, uint32_t size) {
+static void baud_rate_process(uint32_t port) {
     
-    // Check frame size
-    if (size < MB_MIN_REQUEST_SIZE) {
-        return false;
+    port_state_t* state = &ports[port];
+    
+    // Switch baud rate after response transmit
+    if (state->next_baud_rate != 0) {
+        
+        if (transport_is_tx_buffer_free(port) == false || transport_is_tx_complete(port) == false) {
+            return;
+        }
+        
+        transport_set_baud_rate(port, state->next_baud_rate);
+        state->baud_rate = state->next_baud_rate;
+        state->next_baud_rate = 0;
+        state->last_request_time = get_time_ms();
+        return;
     }
     
-    // Check device address
-    if (request[0] != 0xFE && request[0] != 0x68) {
-        return false;
+    // Return to default baud rate if host has not confirmed new baud rate or connection is lost
+    if (state->baud_rate != TRANSPORT_DEFAULT_BAUD_RATE && get_time_ms() - state->last_request_time > BAUD_RATE_FALLBACK_TIMEOUT) {
+        transport_set_baud_rate(port, TRANSPORT_DEFAULT_BAUD_RATE);
+        state->baud_rate = TRANSPORT_DEFAULT_BAUD_RATE;
     }
+}
+
+//  ***************************************************************************
+/// @brief  EEPROM write job process
+/// @note   Job is executed after all requests of current main loop pass are
+///         processed. Request stays in RX buffer until job complete. Commit
+///         job stays pending until VEEPROM stores data to flash
+/// @param  none
+/// @return none
+//  ***************************************************************************
+static void eeprom_job_process(void) {
     
-    // Check CRC
-    uint16_t crc = calculate_crc16(request, size);
-    if (crc != 0) {
-        return false;
+    if (eeprom_job.state != EEPROM_JOB_PENDING) {
+        return;
     }
     
-    return true;
+    eeprom_job.result = MB_OK;
+    if (eeprom_job.function_code == MB_CMD_COMMIT_EEPROM_TRANSACTION) {
+        eeprom_job.result = commit_eeprom_transaction();
+        if (eeprom_job.result == MB_JOB_IN_PROGRESS) {
+            return;
+        }
+    }
+    else if (veeprom_write_bytes(eeprom_job.address, eeprom_job.data, eeprom_job.bytes_count) == false) {
+        eeprom_job.result = MB_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    eeprom_job.state = EEPROM_JOB_DONE;
+}
+
+//  ***************************************************************************
+/// @brief  Telemetry process
+/// @note   Send telemetry frame with data of subscribed RAM ranges:
+///         [address][function code][bytes count][data][CRC]
+/// @param  none
+/// @return none
+//  ***************************************************************************
+static void telemetry_process(void) {
+    
+    static uint32_t prev_frame_time = 0;
+    
+    // Subscription is checked before apply
+    if (telemetry.port == TELEMETRY_PORT_DISABLED) {
+        return;
+    }
+    if (get_time_ms() - prev_frame_time < telemetry.period) {
+        return;
+    }
+    
+    // Requests have priority - wait while request is processing
+    uint32_t port = telemetry.port - 1;
+    if (transport_is_frame_received(port) == true || transport_is_tx_buffer_free(port) == false) {
+        return;
+    }
+    prev_frame_time = get_time_ms();
+    
+    // Make frame
+    uint8_t* frame = transport_get_tx_buffer(port);
+    uint32_t bytes_count = 0;
+    if (ram_map_read_multiple(telemetry.range_list, telemetry.range_count, &frame[3], MAX_READ_RAM_MULTIPLE_SIZE, &bytes_count) == false) {
+        // Range list was checked at subscription apply. Should never happen
+        telemetry.port = TELEMETRY_PORT_DISABLED;
+        telemetry_port = TELEMETRY_PORT_DISABLED;
+        return;
+    }
+    frame[0] = 0xFE;
+    frame[1] = MB_CMD_TELEMETRY;
+    frame[2] = bytes_count;
+    
+    uint32_t frame_size = bytes_count + 3;
+    uint16_t crc = crc16_calculate(frame, frame_size);
+    frame[frame_size++] = crc & 0xFF;
+    frame[frame_size++] = crc >> 8;
+    
+    // Send frame
+    transport_start_tx(port, frame_size);
 }
 
 //  ***************************************************************************
@@ -303,6 +539,44 @@ static uint32_t write_ram_command_handler(const uint8_t* request, uint16_t rq_si
     return MB_OK;
 }
 
+//  ***************************************************************************
+/// @brief  Function for processing ModBus read several RAM ranges command
+/// @note   Request: [address][function][range count][range list][CRC]
+/// @param  request: ModBus request
+/// @param  response ModBus response
+/// @param  rq_size  request size
+/// @param  rs_size  response size
+/// @retval response
+/// @retval rs_size
+/// @return command process result
+//  ***************************************************************************
+static uint32_t read_ram_multiple_command_handler(const uint8_t* request, uint8_t* response, uint16_t rq_size, uint8_t* rs_size) {
+    
+    // Check request size
+    if (rq_size < MB_READ_RAM_MULTIPLE_CMD_MIN_LENGTH) {
+        return MB_BAD_FRAME;
+    }
+    
+    // Parse request parameters
+    uint8_t range_count = request[2];
+    
+    // Check request parameters
+    if (range_count == 0 || rq_size != 5 + range_count * RAM_MAP_RANGE_DESCRIPTOR_SIZE) { // 5: address, function code, range count, CRC
+        return MB_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    
+    // Process command
+    uint32_t bytes_count = 0;
+    if (ram_map_read_multiple(&request[3], range_count, &response[3], MAX_READ_RAM_MULTIPLE_SIZE, &bytes_count) == false) {
+        return MB_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    
+    response[2] = bytes_count;
+    *rs_size += bytes_count + 1; // +1: response[2] = bytes_count;
+    
+    return MB_OK;
+}
+
 //  ***************************************************************************
 /// @brief  Function for processing ModBus read EEPROM command
 /// @param  request: ModBus request
@@ -331,7 +605,9 @@ static uint32_t read_eeprom_command_handler(const uint8_t* request, uint8_t* res
     
     // Process command
     response[2] = bytes_count;
-    veeprom_read_bytes(address, &response[3], bytes_count);
+    if (veeprom_read_bytes(address, &response[3], bytes_count) == false) {
+        return MB_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
     *rs_size += bytes_count + 1; // +1: response[2] = bytes_count;
     
     return MB_OK;
@@ -339,58 +615,240 @@ static uint32_t read_eeprom_command_handler(const uint8_t* request, uint8_t* res
 
 //  ***************************************************************************
 /// @brief  Function for processing ModBus write EEPROM command
+/// @note   Write is executed by background job. Function is called for same
+///         request until job complete
+/// @param  port: transport port index
+/// @param  request: ModBus request
+/// @param  rq_size  request size
+/// @return command process result, MB_JOB_IN_PROGRESS - write in progress
+//  ***************************************************************************
+static uint32_t write_eeprom_command_handler(uint32_t port, const uint8_t* request, uint16_t rq_size) {
+    
+    // Check request size
+    if (rq_size < MB_WRITE_EEPROM_CMD_MIN_LENGTH) {
+        return MB_BAD_FRAME;
+    }
+    
+    // Parse request parameters
+    uint16_t address = (request[2] << 8) | request[3];
+    uint8_t bytes_count = request[4];
+    
+    // Check request parameters
+    if (bytes_count == 0 || bytes_count > MAX_WRITE_EEPROM_SIZE) {
+        return MB_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    
+    return start_eeprom_job(port, request, address, bytes_count, &request[5]);
+}
+
+//  ***************************************************************************
+/// @brief  Function for processing ModBus set baud rate command
+/// @note   Request: [address][function][baud rate, 4 bytes MSB first][CRC]
+/// @param  request: ModBus request
+/// @param  rq_size  request size
+/// @param  baud_rate  baud rate for switch after response transmit
+/// @retval baud_rate
+/// @return command process result
+//  ***************************************************************************
+static uint32_t set_baud_rate_command_handler(const uint8_t* request, uint16_t rq_size, uint32_t* baud_rate) {
+    
+    // Check request size
+    if (rq_size != MB_SET_BAUD_RATE_CMD_LENGTH) {
+        return MB_BAD_FRAME;
+    }
+    
+    // Parse request parameters
+    uint32_t new_baud_rate = (request[2] << 24) | (request[3] << 16) | (request[4] << 8) | request[5];
+    
+    // Check request parameters
+    if (new_baud_rate < MIN_BAUD_RATE || new_baud_rate > MAX_BAUD_RATE) {
+        return MB_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    
+    *baud_rate = new_baud_rate;
+    return MB_OK;
+}
+
+//  ***************************************************************************
+/// @brief  Function for processing ModBus begin EEPROM transaction command
+/// @note   Request: [address][function][VEEPROM address, 2 bytes][size, 2 bytes][CRC]
+///         Response: [address][function][max chunk size][CRC]
+///         Previous not committed transaction is discarded
+/// @param  port: transport port index
 /// @param  request: ModBus request
 /// @param  response ModBus response
 /// @param  rq_size  request size
+/// @param  rs_size  response size
 /// @retval response
+/// @retval rs_size
 /// @return command process result
 //  ***************************************************************************
-static uint32_t write_eeprom_command_handler(const uint8_t* request, uint16_t rq_size) {
+static uint32_t begin_eeprom_transaction_command_handler(uint32_t port, const uint8_t* request, uint8_t* response, uint16_t rq_size, uint8_t* rs_size) {
     
     // Check request size
-    if (rq_size < MB_WRITE_EEPROM_CMD_MIN_LENGTH) {
+    if (rq_size != MB_BEGIN_EEPROM_TRANSACTION_CMD_LENGTH) {
         return MB_BAD_FRAME;
     }
     
     // Parse request parameters
     uint16_t address = (request[2] << 8) | request[3];
-    uint8_t bytes_count = request[4];
+    uint16_t size = (request[4] << 8) | request[5];
     
     // Check request parameters
-    if (bytes_count == 0 || bytes_count > MAX_READ_EEPROM_SIZE) {
+    if (size == 0 || size > MAX_EEPROM_TRANSACTION_SIZE) {
         return MB_EXCEPTION_ILLEGAL_DATA_VALUE;
     }
+    if (address + size > VEEPROM_SIZE) {
+        return MB_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
     
     // Process command
-    if (veeprom_write_bytes(address, &request[5], bytes_count) == false) {
+    eeprom_transaction.is_active = true;
+    eeprom_transaction.port = port;
+    eeprom_transaction.address = address;
+    eeprom_transaction.size = size;
+    eeprom_transaction.received_size = 0;
+    
+    response[2] = MAX_EEPROM_CHUNK_SIZE;
+    *rs_size += 1;
+    
+    return MB_OK;
+}
+
+//  ***************************************************************************
+/// @brief  Function for processing ModBus write EEPROM chunk command
+/// @note   Request: [address][function][offset, 2 bytes][bytes count][data][CRC]
+///         Data is written to staging buffer. Offset should not be greater
+///         than received size: chunk is repeated by host if response is lost
+/// @param  port: transport port index
+/// @param  request: ModBus request
+/// @param  rq_size  request size
+/// @return command process result
+//  ***************************************************************************
+static uint32_t write_eeprom_chunk_command_handler(uint32_t port, const uint8_t* request, uint16_t rq_size) {
+    
+    // Check request size
+    if (rq_size < MB_WRITE_EEPROM_CHUNK_CMD_MIN_LENGTH) {
+        return MB_BAD_FRAME;
+    }
+    
+    // Parse request parameters
+    uint16_t offset = (request[2] << 8) | request[3];
+    uint8_t bytes_count = request[4];
+    
+    // Check request parameters
+    if (eeprom_transaction.is_active == false || eeprom_transaction.port != port) {
+        return MB_EXCEPTION_ILLEGAL_FUNCTION;
+    }
+    if (bytes_count == 0 || bytes_count > MAX_EEPROM_CHUNK_SIZE || rq_size != 7 + bytes_count) { // 7: address, function code, offset, bytes count, CRC
+        return MB_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    if (offset > eeprom_transaction.received_size || offset + bytes_count > eeprom_transaction.size) {
         return MB_EXCEPTION_ILLEGAL_DATA_ADDRESS;
     }
     
+    // Process command
+    memcpy(&eeprom_staging_buffer[offset], &request[5], bytes_count);
+    if (offset + bytes_count > eeprom_transaction.received_size) {
+        eeprom_transaction.received_size = offset + bytes_count;
+    }
+    
     return MB_OK;
 }
 
 //  ***************************************************************************
-/// @brief  Calculate ModBus frame CRC16
-/// @param  frame: ModBus frame
-/// @param  size:  frame size
-/// @return CRC16 value
-//  ***************************************************************************
-static uint16_t calculate_crc16(const uint8_t* frame, uint32_t size) {
-    
-    uint16_t crc16 = 0xFFFF;
-    uint16_t data = 0;
-    uint16_t k = 0;
-    
-    while (size--) {
-        crc16 ^= *frame++;
-        k = 8;
-        while (k--) {
-            data = crc16;
-            crc16 >>= 1;
-            if (data & 0x0001) {
-                crc16 ^= CRC16_POLYNOM;
-            }
+/// @brief  Function for processing ModBus commit EEPROM transaction command
+/// @note   Request: [address][function][size, 2 bytes][data CRC16, 2 bytes][CRC]
+///         Commit is executed by background job. Function is called for same
+///         request until job complete
+/// @param  port: transport port index
+/// @param  request: ModBus request
+/// @param  rq_size  request size
+/// @return command process result, MB_JOB_IN_PROGRESS - commit in progress
+//  ***************************************************************************
+static uint32_t commit_eeprom_transaction_command_handler(uint32_t port, const uint8_t* request, uint16_t rq_size) {
+    
+    // Check request size
+    if (rq_size != MB_COMMIT_EEPROM_TRANSACTION_CMD_LENGTH) {
+        return MB_BAD_FRAME;
+    }
+    
+    // Transaction state is checked by job: transaction is closed on commit
+    return start_eeprom_job(port, request, eeprom_transaction.address, 4, &request[2]); // 4: size, data CRC16
+}
+
+//  ***************************************************************************
+/// @brief  Start EEPROM job for request or get result of complete job
+/// @param  port: transport port index
+/// @param  request: ModBus request
+/// @param  address: VEEPROM address
+/// @param  bytes_count: job data size
+/// @param  data: job data
+/// @return job result, MB_JOB_IN_PROGRESS - job in progress
+//  ***************************************************************************
+static uint32_t start_eeprom_job(uint32_t port, const uint8_t* request, uint16_t address, uint8_t bytes_count, const uint8_t* data) {
+    
+    // Check job is complete for this request
+    if (eeprom_job.state == EEPROM_JOB_DONE && eeprom_job.port == port && eeprom_job.function_code == request[1] &&
+        eeprom_job.address == address && eeprom_job.bytes_count == bytes_count && memcmp(eeprom_job.data, data, bytes_count) == 0) {
+        
+        eeprom_job.state = EEPROM_JOB_IDLE;
+        return eeprom_job.result;
+    }
+    
+    // Start job. Result of job for dropped request is discarded
+    if (eeprom_job.state != EEPROM_JOB_PENDING) {
+        eeprom_job.state = EEPROM_JOB_PENDING;
+        eeprom_job.port = port;
+        eeprom_job.function_code = request[1];
+        eeprom_job.address = address;
+        eeprom_job.bytes_count = bytes_count;
+        eeprom_job.is_flush_started = false;
+        memcpy(eeprom_job.data, data, bytes_count);
+    }
+    return MB_JOB_IN_PROGRESS;
+}
+
+//  ***************************************************************************
+/// @brief  Check and commit EEPROM transaction
+/// @note   Job data: [size, 2 bytes][data CRC16, 2 bytes]. Staging buffer is
+///         written to VEEPROM and flushed to flash by veeprom_process(): each
+///         changed VEEPROM block is programmed once
+/// @param  none
+/// @return command process result, MB_JOB_IN_PROGRESS - flush in progress
+//  ***************************************************************************
+static uint32_t commit_eeprom_transaction(void) {
+    
+    // Wait data is stored to flash
+    if (eeprom_job.is_flush_started == true) {
+        
+        if (veeprom_is_dirty() == false && veeprom_is_busy() == false) {
+            return MB_OK;
+        }
+        if (get_time_ms() - eeprom_job.flush_start_time > EEPROM_COMMIT_TIMEOUT) {
+            return MB_EXCEPTION_SLAVE_DEV_FAILURE;
         }
+        return MB_JOB_IN_PROGRESS;
     }
-    return crc16;
-}
\ No newline at end of file
+    
+    uint16_t size = (eeprom_job.data[0] << 8) | eeprom_job.data[1];
+    uint16_t crc = (eeprom_job.data[2] << 8) | eeprom_job.data[3];
+    
+    if (eeprom_transaction.is_active == false || eeprom_transaction.port != eeprom_job.port) {
+        return MB_EXCEPTION_ILLEGAL_FUNCTION;
+    }
+    if (size != eeprom_transaction.size || eeprom_transaction.received_size != eeprom_transaction.size ||
+        crc16_calculate(eeprom_staging_buffer, size) != crc) {
+        return MB_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    
+    eeprom_transaction.is_active = false;
+    if (veeprom_write_bytes(eeprom_transaction.address, eeprom_staging_buffer, size) == false) {
+        return MB_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    
+    veeprom_flush();
+    eeprom_job.is_flush_started = true;
+    eeprom_job.flush_start_time = get_time_ms();
+    return MB_JOB_IN_PROGRESS;
+}
@@ -8,8 +8,7 @@
 #include <sam.h>
 #include <stdbool.h>
 #include "adc.h"
-#include "veeprom_map.h"
-#include "veeprom.h"
+#include "configuration.h"
 #include "systimer.h"
 #include "error_handling.h"
 
@@ -143,18 +142,21 @@ bool monitoring_is_low_battery_voltage(void) {
 //  ***************************************************************************
 static bool read_configuration(void) {
     
+    const configuration_t* configuration = configuration_get();
+    if (configuration == NULL) {
+        return false;
+    }
+    
     for (uint32_t i = 0; i < SUPPORT_ADC_CHANNEL_COUNT; ++i) {
         
-        uint32_t base_address = VOLTAGE_DIVISOR_CONFIGURATION_BASE_EE_ADDRESS + i * VOLTAGE_DIVISOR_CONFIGURATION_SIZE;
-        
-        voltage_divisor[i].up_resist   = veeprom_read_32(base_address + VOLTAGE_DIVISOR_UP_RESIST_OFFSET);
-        voltage_divisor[i].down_resist = veeprom_read_32(base_address + VOLTAGE_DIVISOR_DOWN_RESIST_OFFSET);
+        voltage_divisor[i].up_resist   = configuration->voltage_divisors[i].up_resist;
+        voltage_divisor[i].down_resist = configuration->voltage_divisors[i].down_resist;
         if (voltage_divisor[i].up_resist == 0xFFFFFFFF || voltage_divisor[i].down_resist == 0xFFFFFFFF) {
             return false;
         }
     }
     
-    battery_low_voltage_threshold = veeprom_read_8(BATTERY_LOW_VOLTAGE_THRESHOLD_EE_ADDRESS);
+    battery_low_voltage_threshold = configuration->battery_low_voltage_threshold;
     if (battery_low_voltage_threshold == 0xFF) {
         return false;
     }
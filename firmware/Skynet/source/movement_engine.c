@@ -6,8 +6,8 @@
 
 #include <sam.h>
 #include <stdlib.h>
-#include "veeprom.h"
-#include "veeprom_map.h"
+#include <string.h>
+#include "configuration.h"
 #include "limbs_driver.h"
 #include "gait_sequences.h"
 #include "orientation.h"
@@ -48,7 +48,11 @@ static const sequence_info_t* next_sequence_info = NULL;
 static uint32_t front_distance_low_limit = 0;
 
 
+static uint8_t scr_cmd_to_sequence_map[256] = {0};     // SCR command code -> sequence ID
+
+
 static bool read_configuration(void);
+static bool is_sequence_preconditions_met(uint8_t preconditions);
 
 
 //  ***************************************************************************
@@ -58,6 +62,14 @@ static bool read_configuration(void);
 //  ***************************************************************************
 void movement_engine_init(void) {
     
+    // Build SCR command code to sequence ID map from sequence registry
+    memset(scr_cmd_to_sequence_map, SUPPORT_SEQUENCE_COUNT, sizeof(scr_cmd_to_sequence_map));
+    for (uint32_t i = 0; i < SUPPORT_SEQUENCE_COUNT; ++i) {
+        if (sequence_registry[i].scr_cmd != 0x00) {
+            scr_cmd_to_sequence_map[sequence_registry[i].scr_cmd] = i;
+        }
+    }
+    
     if (read_configuration() == false) {
         callback_set_config_error(ERROR_MODULE_MOVEMENT_ENGINE);
         return;
@@ -67,7 +79,7 @@ void movement_engine_init(void) {
     current_sequence      = SEQUENCE_NONE;
     current_sequence_info = NULL;
     next_sequence         = SEQUENCE_DOWN;
-    next_sequence_info    = &sequence_down;
+    next_sequence_info    = sequence_registry[SEQUENCE_DOWN].info;
     
     driver_state          = STATE_IDLE;
 }
@@ -161,9 +173,9 @@ void movement_engine_process(void) {
     }
     
     // Stop hexapod direct movement if distance to object very low
-    if (current_sequence == SEQUENCE_DIRECT_MOVEMENT || current_sequence == SEQUENCE_DIRECT_MOVEMENT_SLOW) {
+    if (sequence_registry[current_sequence].preconditions & SEQUENCE_PRECONDITION_FRONT_DISTANCE) {
         
-        if (current_orientation.front_distance < front_distance_low_limit) {
+        if (is_sequence_preconditions_met(SEQUENCE_PRECONDITION_FRONT_DISTANCE) == false) {
             movement_engine_select_sequence(SEQUENCE_NONE);
         }
     }
@@ -176,137 +188,38 @@ void movement_engine_process(void) {
 //  ***************************************************************************
 void movement_engine_select_sequence(sequence_id_t sequence) {
     
+    if (sequence >= SUPPORT_SEQUENCE_COUNT) {
+        callback_set_internal_error(ERROR_MODULE_MOVEMENT_ENGINE);
+        return;
+    }
+    
+    const sequence_descriptor_t* descriptor = &sequence_registry[sequence];
+    if (sequence != SEQUENCE_NONE && descriptor->info == NULL) {
+        callback_set_internal_error(ERROR_MODULE_MOVEMENT_ENGINE);
+        return;
+    }
+    
     // Request switch current sequence
-    switch (sequence) {
-        
-        case SEQUENCE_NONE:
-            next_sequence = SEQUENCE_NONE;
-            next_sequence_info = NULL;
-            break;
-        
-        case SEQUENCE_UP:
-            if (hexapod_state == HEXAPOD_STATE_DOWN) {
-                next_sequence = SEQUENCE_UP;
-                next_sequence_info = &sequence_up;
-            }
-            break;
-
-        case SEQUENCE_DOWN:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_DOWN;
-                next_sequence_info = &sequence_down;
-            }
-            break;
-            
-        case SEQUENCE_RUN:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_RUN;
-                next_sequence_info = &sequence_run;
-            }
-            break;
-
-        case SEQUENCE_DIRECT_MOVEMENT:
-            if (hexapod_state == HEXAPOD_STATE_UP && current_orientation.front_distance >= front_distance_low_limit) {
-                next_sequence = SEQUENCE_DIRECT_MOVEMENT;
-                next_sequence_info = &sequence_direct_movement;
-            }
-            break;
-
-        case SEQUENCE_REVERSE_MOVEMENT: 
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_REVERSE_MOVEMENT;
-                next_sequence_info = &sequence_reverse_movement;
-            }
-            break;
-
-        case SEQUENCE_ROTATE_LEFT:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_ROTATE_LEFT;
-                next_sequence_info = &sequence_rotate_left;
-            }
-            break;
-
-        case SEQUENCE_ROTATE_RIGHT:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_ROTATE_RIGHT;
-                next_sequence_info = &sequence_rotate_right;
-            }
-            break;
-        
-        case SEQUENCE_DIRECT_MOVEMENT_SLOW:
-            if (hexapod_state == HEXAPOD_STATE_UP && current_orientation.front_distance >= front_distance_low_limit) {
-                next_sequence = SEQUENCE_DIRECT_MOVEMENT_SLOW;
-                next_sequence_info = &sequence_direct_movement_slow;
-            }
-            break;
-
-        case SEQUENCE_REVERSE_MOVEMENT_SLOW:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_REVERSE_MOVEMENT_SLOW;
-                next_sequence_info = &sequence_reverse_movement_slow;
-            }
-            break;
-
-        case SEQUENCE_SHIFT_LEFT:
-             if (hexapod_state == HEXAPOD_STATE_UP) {
-                 next_sequence = SEQUENCE_SHIFT_LEFT;
-                 next_sequence_info = &sequence_shift_left;
-             }
-             break;
-             
-        case SEQUENCE_SHIFT_RIGHT:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_SHIFT_RIGHT;
-                next_sequence_info = &sequence_shift_right;
-            }
-            break;
- 
-        case SEQUENCE_ATTACK_LEFT:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_ATTACK_LEFT;
-                next_sequence_info = &sequence_attack_left;
-            }
-            break;
-            
-        case SEQUENCE_ATTACK_RIGHT:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_ATTACK_RIGHT;
-                next_sequence_info = &sequence_attack_right;
-            }
-            break;
-            
-        case SEQUENCE_DANCE:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_DANCE;
-                next_sequence_info = &sequence_dance;
-            }
-            break;
-            
-        case SEQUENCE_ROTATE_X:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_ROTATE_X;
-                next_sequence_info = &sequence_rotate_x;
-            }
-            break;
-            
-        /*case SEQUENCE_ROTATE_Y:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_ROTATE_Y;
-                next_sequence_info = &sequence_rotate_y;
-            }
-            break;*/
-            
-        case SEQUENCE_ROTATE_Z:
-            if (hexapod_state == HEXAPOD_STATE_UP) {
-                next_sequence = SEQUENCE_ROTATE_Z;
-                next_sequence_info = &sequence_rotate_z;
-            }
-            break;
+    if (is_sequence_preconditions_met(descriptor->preconditions) == true) {
+        next_sequence = sequence;
+        next_sequence_info = descriptor->info;
+    }
+}
 
-        default:
-            callback_set_internal_error(ERROR_MODULE_MOVEMENT_ENGINE);
-            return;
+//  ***************************************************************************
+/// @brief  Select sequence by SCR command code
+/// @param  scr_cmd: SCR command code
+/// @return true - command is sequence select command, false - unknown command
+//  ***************************************************************************
+bool movement_engine_select_sequence_by_scr_cmd(uint8_t scr_cmd) {
+    
+    uint8_t sequence = scr_cmd_to_sequence_map[scr_cmd];
+    if (sequence >= SUPPORT_SEQUENCE_COUNT) {
+        return false;
     }
+    
+    movement_engine_select_sequence((sequence_id_t)sequence);
+    return true;
 }
 
 
@@ -319,6 +232,30 @@ void movement_engine_select_sequence(sequence_id_t sequence) {
 //  ***************************************************************************
 static bool read_configuration(void) {
    
-    front_distance_low_limit = veeprom_read_32(FRONT_DISTANCE_LOW_LIMIT_EE_ADDRESS);
+    const configuration_t* configuration = configuration_get();
+    if (configuration == NULL) {
+        return false;
+    }
+    
+    front_distance_low_limit = configuration->front_distance_low_limit;
+    return true;
+}
+
+//  ***************************************************************************
+/// @brief  Check sequence preconditions
+/// @param  preconditions: SEQUENCE_PRECONDITION_xxx flags
+/// @return true - all preconditions met, false - otherwise
+//  ***************************************************************************
+static bool is_sequence_preconditions_met(uint8_t preconditions) {
+    
+    if ((preconditions & SEQUENCE_PRECONDITION_HEXAPOD_DOWN) && hexapod_state != HEXAPOD_STATE_DOWN) {
+        return false;
+    }
+    if ((preconditions & SEQUENCE_PRECONDITION_HEXAPOD_UP) && hexapod_state != HEXAPOD_STATE_UP) {
+        return false;
+    }
+    if ((preconditions & SEQUENCE_PRECONDITION_FRONT_DISTANCE) && current_orientation.front_distance < front_distance_low_limit) {
+        return false;
+    }
     return true;
 }
@@ -5,7 +5,6 @@
 #include "oled_gl.h"
 
 #include <sam.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -27,6 +26,10 @@ typedef enum {
 static driver_state_t driver_state = STATE_NOINIT;
 
 
+static void draw_symbols(uint32_t row, uint32_t x, const char* symbols, uint32_t count);
+static char* format_dec_number(char* end, uint32_t number, uint32_t min_digits);
+
+
 //  ***************************************************************************
 /// @brief    Graphic library initialization
 /// @param    none
@@ -82,6 +85,7 @@ void oled_gl_clear_display(void) {
 
 //  ***************************************************************************
 /// @brief    Draw float number in format n.X
+/// @note     Use oled_gl_draw_fixed_number() if number is fixed point value
 /// @param    row: display row [0; 7]
 /// @param    x: first symbol position
 /// @param    number: number for draw
@@ -89,10 +93,53 @@ void oled_gl_clear_display(void) {
 //  ***************************************************************************
 void oled_gl_draw_float_number(uint32_t row, uint32_t x, float number) {
     
-    char buffer[12] = {0};
-    sprintf(buffer, "%04.1f", number);
+    int32_t fixed = (int32_t)((number < 0) ? (number * 10.0f - 0.5f) : (number * 10.0f + 0.5f));
+    oled_gl_draw_fixed_number(row, x, fixed, 1, 4);
+}
+
+//  ***************************************************************************
+/// @brief    Draw fixed point number
+/// @note     Format is equal to printf("%0*.*f") for number / 10^fraction_digits
+/// @param    row: display row [0; 7]
+/// @param    x: first symbol position
+/// @param    number: number for draw (in units of last fraction digit)
+/// @param    fraction_digits: fraction digits count (0 - integer)
+/// @param    width: minimum symbols count (include sign and point)
+/// @return    none
+//  ***************************************************************************
+void oled_gl_draw_fixed_number(uint32_t row, uint32_t x, int32_t number, uint32_t fraction_digits, uint32_t width) {
+    
+    char buffer[16];
+    char* end = &buffer[sizeof(buffer)];
+    
+    if (fraction_digits > 4) {
+        fraction_digits = 4;
+    }
+    bool is_negative = (number < 0);
+    uint32_t value = (is_negative == true) ? (0u - (uint32_t)number) : (uint32_t)number;
     
-    oled_gl_draw_string(row, x, buffer);
+    // Fraction part
+    char* begin = end;
+    for (uint32_t i = 0; i < fraction_digits; ++i) {
+        *(--begin) = '0' + (value % 10);
+        value /= 10;
+    }
+    if (fraction_digits != 0) {
+        *(--begin) = '.';
+    }
+    
+    // Integer part with zero padding
+    uint32_t symbols_count = (end - begin) + ((is_negative == true) ? 1 : 0);
+    uint32_t min_digits = (width > symbols_count) ? (width - symbols_count) : 1;
+    if (min_digits > 10) {
+        min_digits = 10;
+    }
+    begin = format_dec_number(begin, value, min_digits);
+    
+    if (is_negative == true) {
+        *(--begin) = '-';
+    }
+    draw_symbols(row, x, begin, end - begin);
 }
 
 //  ***************************************************************************
@@ -104,10 +151,7 @@ void oled_gl_draw_float_number(uint32_t row, uint32_t x, float number) {
 //  ***************************************************************************
 void oled_gl_draw_dec_number(uint32_t row, uint32_t x, int32_t number) {
     
-    char buffer[12] = {0};
-    sprintf(buffer, "%d", (int)number);
-    
-    oled_gl_draw_string(row, x, buffer);
+    oled_gl_draw_fixed_number(row, x, number, 0, 0);
 }
 
 //  ***************************************************************************
@@ -119,11 +163,13 @@ void oled_gl_draw_dec_number(uint32_t row, uint32_t x, int32_t number) {
 //  ***************************************************************************
 void oled_gl_draw_hex_number(uint32_t row, uint32_t x, uint32_t number) {
     
-    char buffer[32] = {0};
-    sprintf(buffer, "%#010X", (int)number);
-    buffer[1] = 'x';
+    char buffer[10] = {'0', 'x'};
+    for (uint32_t i = 9; i >= 2; --i, number >>= 4) {
+        uint32_t digit = number & 0x0F;
+        buffer[i] = (digit < 10) ? ('0' + digit) : ('A' + digit - 10);
+    }
     
-    oled_gl_draw_string(row, x, buffer);
+    draw_symbols(row, x, buffer, sizeof(buffer));
 }
 
 //  ***************************************************************************
@@ -135,9 +181,42 @@ void oled_gl_draw_hex_number(uint32_t row, uint32_t x, uint32_t number) {
 //  ***************************************************************************
 void oled_gl_draw_string(uint32_t row, uint32_t x, const char* str) {
     
-    uint8_t* frame_buffer = ssd1306_128x64_get_frame_buffer(row, x);
-    for (uint32_t i = 0; *str != '\0'; ++str, i += 6) {
-        memcpy(&frame_buffer[i], &font_6x8[(*str - ' ') * 6], 6);
+    draw_symbols(row, x, str, strlen(str));
+}
+
+//  ***************************************************************************
+/// @brief    Draw string at any vertical position
+/// @note     Symbol can cross display rows border
+/// @param    x: first symbol position
+/// @param    y: top line of symbols [0; 63]
+/// @param    str: string for draw
+/// @return    none
+//  ***************************************************************************
+void oled_gl_draw_string_xy(uint32_t x, uint32_t y, const char* str) {
+    
+    uint32_t row = y / 8;
+    uint32_t shift = y % 8;
+    if (row >= DISPLAY_HEIGHT / 8) return;
+    
+    uint8_t top_mask = (uint8_t)(0xFF << shift);
+    uint8_t bottom_mask = (uint8_t)~top_mask;
+    bool is_bottom_row_used = (shift != 0 && row + 1 < DISPLAY_HEIGHT / 8);
+    
+    for (; *str != '\0' && x + 6 <= DISPLAY_WIDTH; ++str, x += 6) {
+        
+        const uint8_t* glyph = &font_6x8[((uint8_t)(*str - ' ') % 96) * 6];
+        
+        uint8_t* top = ssd1306_128x64_get_frame_buffer(row, x);
+        for (uint32_t i = 0; i < 6; ++i) {
+            top[i] = (top[i] & ~top_mask) | (uint8_t)(glyph[i] << shift);
+        }
+        
+        if (is_bottom_row_used == true) {
+            uint8_t* bottom = ssd1306_128x64_get_frame_buffer(row + 1, x);
+            for (uint32_t i = 0; i < 6; ++i) {
+                bottom[i] = (bottom[i] & ~bottom_mask) | (uint8_t)(glyph[i] >> (8 - shift));
+            }
+        }
     }
 }
 
@@ -257,17 +336,18 @@ void oled_gl_async_display_update_process(void) {
             break;
         
         case STATE_UPDATE_ROW:
-            if (ssd1306_128x64_start_async_update_row(current_row) == false) {
-                callback_set_i2c_error(ERROR_MODULE_GUI);
-            }
-            
-            ++current_row;
             if (current_row >= 8) {
                 current_row = 0;
-                driver_state = STATE_IDLE;
+                driver_state = STATE_IDLE; // Last row transfer complete
                 break;
             }
             
+            // Transfer is not started for unchanged row
+            if (ssd1306_128x64_start_async_update_row(current_row) == false) {
+                callback_set_i2c_error(ERROR_MODULE_GUI);
+            }
+            
+            ++current_row;
             driver_state = STATE_WAIT;
             break;
             
@@ -288,4 +368,55 @@ void oled_gl_async_display_update_process(void) {
             callback_set_internal_error(ERROR_MODULE_GUI);
             break;
     }
+}
+
+//  ***************************************************************************
+/// @brief    Check asynchronous display update complete
+/// @param    none
+/// @return    true - update complete, false - update in progress
+//  ***************************************************************************
+bool oled_gl_is_async_display_update_complete(void) {
+    
+    return driver_state == STATE_IDLE;
+}
+
+
+
+
+
+//  ***************************************************************************
+/// @brief    Copy symbol glyphs to frame buffer
+/// @note     Symbols out of display are not drawn
+/// @param    row: display row [0; 7]
+/// @param    x: first symbol position
+/// @param    symbols: symbols for draw
+/// @param    count: symbols count
+/// @return    none
+//  ***************************************************************************
+static void draw_symbols(uint32_t row, uint32_t x, const char* symbols, uint32_t count) {
+    
+    uint8_t* frame_buffer = ssd1306_128x64_get_frame_buffer(row, x);
+    for (uint32_t i = 0; i < count && x + 6 <= DISPLAY_WIDTH; ++i, x += 6, frame_buffer += 6) {
+        memcpy(frame_buffer, &font_6x8[((uint8_t)(symbols[i] - ' ') % 96) * 6], 6);
+    }
+}
+
+//  ***************************************************************************
+/// @brief    Convert unsigned number to DEC symbols
+/// @note     Symbols are written from end to begin of buffer
+/// @param    end: pointer to end of buffer
+/// @param    number: number for convert
+/// @param    min_digits: minimum digits count (zero padding)
+/// @return    pointer to first symbol
+//  ***************************************************************************
+static char* format_dec_number(char* end, uint32_t number, uint32_t min_digits) {
+    
+    uint32_t digits = 0;
+    do {
+        *(--end) = '0' + (number % 10);
+        number /= 10;
+        ++digits;
+    } while (number != 0 || digits < min_digits);
+    
+    return end;
 }
\ No newline at end of file
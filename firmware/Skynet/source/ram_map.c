@@ -6,26 +6,40 @@
 
 #include <sam.h>
 #include <stdlib.h>
+#include <string.h>
 #include "limbs_driver.h"
 #include "monitoring.h"
 #include "orientation.h"
 #include "scr.h"
+#include "modbus.h"
 #include "error_handling.h"
 #include "version.h"
-        
-#define RAM_PUT_BYTE(ram_addr, var)  .data[ram_addr] = (uint8_t*)&(var)
+#include "pwm.h"
+#include "veeprom.h"
+#include "boot.h"
+
+#define RAM_ACCESS_R                 (0x01)
+#define RAM_ACCESS_W                 (0x02)
+#define RAM_ACCESS_RW                (RAM_ACCESS_R | RAM_ACCESS_W)
+#define RAM_ACCESS_SYNC              (0x04)     // Write is staged and applied at next synchro boundary
 
-#define RAM_PUT_WORD(ram_addr, var)  .data[(ram_addr) + 0] = ((uint8_t*)&(var)) + 1,    \
-                                     .data[(ram_addr) + 1] = ((uint8_t*)&(var)) + 0
+#define RAM_REGION(ram_addr, var, var_size, word_sz, acc, callback)                                     \
+                                     { .address = (ram_addr), .size = (var_size), .word_size = (word_sz), \
+                                       .access = (acc), .data = (uint8_t*)&(var), .write_callback = (callback) }
 
-#define RAM_PUT_DWORD(ram_addr, var) .data[(ram_addr) + 0] = ((uint8_t*)&(var)) + 3,    \
-                                     .data[(ram_addr) + 1] = ((uint8_t*)&(var)) + 2,    \
-                                     .data[(ram_addr) + 2] = ((uint8_t*)&(var)) + 1,    \
-                                     .data[(ram_addr) + 3] = ((uint8_t*)&(var)) + 0
+#define RAM_PUT_BYTE(ram_addr, var, acc)   RAM_REGION(ram_addr, var, 1, 1, acc, NULL)
+#define RAM_PUT_WORD(ram_addr, var, acc)   RAM_REGION(ram_addr, var, 2, 2, acc, NULL)
+#define RAM_PUT_DWORD(ram_addr, var, acc)  RAM_REGION(ram_addr, var, 4, 4, acc, NULL)
+#define RAM_PUT_ARRAY(ram_addr, var, acc)  RAM_REGION(ram_addr, var, sizeof(var), 1, acc, NULL)
 
 typedef struct {
-    uint8_t* data[RAM_MAP_SIZE];
-} ram_map_t;
+    uint16_t address;                   // Region begin address
+    uint16_t size;                      // Region size
+    uint8_t  word_size;                 // Big-endian element size (1 - byte array, copied as is)
+    uint8_t  access;                    // RAM_ACCESS_xxx flags
+    uint8_t* data;                      // Pointer to variable
+    bool   (*write_callback)(void);     // Call after write to region (can be NULL)
+} ram_region_t;
 
 
 static const uint32_t device_id    = DEVICE_ID;
@@ -33,62 +47,56 @@ static const uint8_t  version_main = VERSION_MAIN;
 static const uint8_t  version_sub  = VERSION_SUB;
 static const uint8_t  version_aux  = VERSION_AUX;
 
-static const ram_map_t ram_map = {
-    
-    RAM_PUT_DWORD(0x0000, device_id),
-    RAM_PUT_BYTE (0x000D, version_main),
-    RAM_PUT_BYTE (0x000E, version_sub),
-    RAM_PUT_BYTE (0x000F, version_aux),
-    RAM_PUT_WORD (0x0010, error_status),
-    RAM_PUT_BYTE (0x0012, wireless_voltage),
-    RAM_PUT_BYTE (0x0013, sensors_voltage),
-    RAM_PUT_BYTE (0x0014, battery_voltage),
-    RAM_PUT_BYTE (0x0015, orientation_sensors_status),
-    
-    RAM_PUT_DWORD(0x0016, current_orientation.front_distance),
-    
-    RAM_PUT_BYTE (0x0060, scr),
-    RAM_PUT_DWORD(0x0061, scr_argument),
-    
-    RAM_PUT_BYTE (0x00C0, ram_link_angles[0]),
-    RAM_PUT_BYTE (0x00C1, ram_link_angles[1]),
-    RAM_PUT_BYTE (0x00C2, ram_link_angles[2]),
-    RAM_PUT_BYTE (0x00C3, ram_link_angles[3]),
-    RAM_PUT_BYTE (0x00C4, ram_link_angles[4]),
-    RAM_PUT_BYTE (0x00C5, ram_link_angles[5]),
-    RAM_PUT_BYTE (0x00C6, ram_link_angles[6]),
-    RAM_PUT_BYTE (0x00C7, ram_link_angles[7]),
-    RAM_PUT_BYTE (0x00C8, ram_link_angles[8]),
-    RAM_PUT_BYTE (0x00C9, ram_link_angles[9]),
-    RAM_PUT_BYTE (0x00CA, ram_link_angles[10]),
-    RAM_PUT_BYTE (0x00CB, ram_link_angles[11]),
-    RAM_PUT_BYTE (0x00CC, ram_link_angles[12]),
-    RAM_PUT_BYTE (0x00CD, ram_link_angles[13]),
-    RAM_PUT_BYTE (0x00CE, ram_link_angles[14]),
-    RAM_PUT_BYTE (0x00CF, ram_link_angles[15]),
-    RAM_PUT_BYTE (0x00D0, ram_link_angles[16]),
-    RAM_PUT_BYTE (0x00D1, ram_link_angles[17]),
-    
-    RAM_PUT_BYTE (0x00E0, ram_link_angles_override[0]),
-    RAM_PUT_BYTE (0x00E1, ram_link_angles_override[1]),
-    RAM_PUT_BYTE (0x00E2, ram_link_angles_override[2]),
-    RAM_PUT_BYTE (0x00E3, ram_link_angles_override[3]),
-    RAM_PUT_BYTE (0x00E4, ram_link_angles_override[4]),
-    RAM_PUT_BYTE (0x00E5, ram_link_angles_override[5]),
-    RAM_PUT_BYTE (0x00E6, ram_link_angles_override[6]),
-    RAM_PUT_BYTE (0x00E7, ram_link_angles_override[7]),
-    RAM_PUT_BYTE (0x00E8, ram_link_angles_override[8]),
-    RAM_PUT_BYTE (0x00E9, ram_link_angles_override[9]),
-    RAM_PUT_BYTE (0x00EA, ram_link_angles_override[10]),
-    RAM_PUT_BYTE (0x00EB, ram_link_angles_override[11]),
-    RAM_PUT_BYTE (0x00EC, ram_link_angles_override[12]),
-    RAM_PUT_BYTE (0x00ED, ram_link_angles_override[13]),
-    RAM_PUT_BYTE (0x00EE, ram_link_angles_override[14]),
-    RAM_PUT_BYTE (0x00EF, ram_link_angles_override[15]),
-    RAM_PUT_BYTE (0x00F0, ram_link_angles_override[16]),
-    RAM_PUT_BYTE (0x00F1, ram_link_angles_override[17])
+//
+// RAM map. Regions should be sorted by address and should not overlap
+//
+static const ram_region_t ram_map[] = {
+    
+    RAM_PUT_DWORD(0x0000, device_id,                           RAM_ACCESS_R),
+    RAM_PUT_BYTE (0x000D, version_main,                        RAM_ACCESS_R),
+    RAM_PUT_BYTE (0x000E, version_sub,                         RAM_ACCESS_R),
+    RAM_PUT_BYTE (0x000F, version_aux,                         RAM_ACCESS_R),
+    RAM_PUT_WORD (0x0010, error_status,                        RAM_ACCESS_R),
+    RAM_PUT_BYTE (0x0012, wireless_voltage,                    RAM_ACCESS_R),
+    RAM_PUT_BYTE (0x0013, sensors_voltage,                     RAM_ACCESS_R),
+    RAM_PUT_BYTE (0x0014, battery_voltage,                     RAM_ACCESS_R),
+    RAM_PUT_BYTE (0x0015, orientation_sensors_status,          RAM_ACCESS_R),
+    
+    RAM_PUT_DWORD(0x0016, current_orientation.front_distance,  RAM_ACCESS_R),
+    RAM_PUT_DWORD(0x001A, veeprom_crc,                         RAM_ACCESS_R),
+    RAM_PUT_WORD (0x001E, veeprom_bad_pages,                   RAM_ACCESS_R),
+    RAM_REGION   (0x0020, boot_timeline, sizeof(boot_timeline), 4, RAM_ACCESS_R, NULL),
+    
+    RAM_REGION   (0x0060, scr, 1, 1,                           RAM_ACCESS_RW, scr_push_command),
+    RAM_PUT_DWORD(0x0061, scr_argument,                        RAM_ACCESS_RW),
+    RAM_PUT_BYTE (0x0065, scr_last_queued_id,                  RAM_ACCESS_R),
+    RAM_PUT_BYTE (0x0066, scr_last_completed_id,               RAM_ACCESS_R),
+    
+    RAM_PUT_ARRAY(0x00C0, ram_link_angles,                     RAM_ACCESS_R),
+    RAM_PUT_ARRAY(0x00E0, ram_link_angles_override,            RAM_ACCESS_RW | RAM_ACCESS_SYNC),
+    
+    RAM_REGION   (0x0100, telemetry_port, 1, 1,                RAM_ACCESS_RW, modbus_apply_telemetry_subscription),
+    RAM_PUT_WORD (0x0101, telemetry_period,                    RAM_ACCESS_RW),
+    RAM_PUT_BYTE (0x0103, telemetry_range_count,               RAM_ACCESS_RW),
+    RAM_REGION   (0x0104, telemetry_range_list, TELEMETRY_MAX_RANGE_COUNT * RAM_MAP_RANGE_DESCRIPTOR_SIZE, 1, RAM_ACCESS_RW, NULL)
 };
 
+#define RAM_MAP_REGION_COUNT         (sizeof(ram_map) / sizeof(ram_map[0]))
+
+
+// Staged data for RAM_ACCESS_SYNC regions. SYNC regions are placed in shadow one after another
+#define SYNC_SHADOW_SIZE             (sizeof(ram_link_angles_override))
+
+static uint8_t  sync_shadow[SYNC_SHADOW_SIZE] = {0};
+static uint32_t sync_dirty_bits[(SYNC_SHADOW_SIZE + 31) / 32] = {0};
+static bool     is_sync_data_staged = false;
+
+
+static uint32_t find_first_region(uint32_t ram_address);
+static uint32_t get_sync_shadow_offset(uint32_t region_index);
+static void copy_from_region(const ram_region_t* region, uint32_t offset, uint8_t* buffer, uint32_t bytes_count);
+static void copy_to_region(const ram_region_t* region, uint32_t offset, const uint8_t* buffer, uint32_t bytes_count);
+
 
 //  ***************************************************************************
 /// @brief    Read RAM to external buffer
@@ -99,12 +107,22 @@ static const ram_map_t ram_map = {
 //  ***************************************************************************
 bool ram_map_read(uint32_t ram_address, uint8_t* buffer, uint32_t bytes_count) {
     
-    if (ram_address + bytes_count >= RAM_MAP_SIZE) {
+    if (ram_address + bytes_count > RAM_MAP_SIZE) {
         return false;    
     }
     
-    for (uint32_t i = 0; i < bytes_count; ++i) {
-        buffer[i] = (ram_map.data[ram_address + i] != NULL) ? *(ram_map.data[ram_address + i]) : 0;
+    // Not mapped or not readable addresses are read as 0x00
+    memset(buffer, 0x00, bytes_count);
+    
+    uint32_t end_address = ram_address + bytes_count;
+    for (uint32_t i = find_first_region(ram_address); i < RAM_MAP_REGION_COUNT && ram_map[i].address < end_address; ++i) {
+        
+        const ram_region_t* region = &ram_map[i];
+        if ((region->access & RAM_ACCESS_R) == 0) continue;
+        
+        uint32_t begin = (region->address > ram_address) ? region->address : ram_address;
+        uint32_t end = (region->address + region->size < end_address) ? region->address + region->size : end_address;
+        copy_from_region(region, begin - region->address, &buffer[begin - ram_address], end - begin);
     }
     
     return true;
@@ -119,16 +137,200 @@ bool ram_map_read(uint32_t ram_address, uint8_t* buffer, uint32_t bytes_count) {
 //  ***************************************************************************
 bool ram_map_write(uint32_t ram_address, const uint8_t* buffer, uint32_t bytes_count) {
     
-    if (ram_address + bytes_count >= RAM_MAP_SIZE) {
+    if (ram_address + bytes_count > RAM_MAP_SIZE) {
         return false;
     }
     
-    for (uint32_t i = 0; i < bytes_count; ++i) {
+    // Not mapped or not writable addresses are ignored
+    uint32_t end_address = ram_address + bytes_count;
+    uint32_t first_region = find_first_region(ram_address);
+    for (uint32_t i = first_region; i < RAM_MAP_REGION_COUNT && ram_map[i].address < end_address; ++i) {
+        
+        const ram_region_t* region = &ram_map[i];
+        if ((region->access & RAM_ACCESS_W) == 0) continue;
+        
+        uint32_t begin = (region->address > ram_address) ? region->address : ram_address;
+        uint32_t end = (region->address + region->size < end_address) ? region->address + region->size : end_address;
+        
+        if (region->access & RAM_ACCESS_SYNC) {
+            
+            // Stage data. All data of write transaction will be applied together
+            uint32_t shadow_offset = get_sync_shadow_offset(i) + (begin - region->address);
+            if (shadow_offset + (end - begin) > SYNC_SHADOW_SIZE) {
+                return false; // SYNC_SHADOW_SIZE is less than total size of SYNC regions
+            }
+            memcpy(&sync_shadow[shadow_offset], &buffer[begin - ram_address], end - begin);
+            for (uint32_t offset = shadow_offset; offset < shadow_offset + (end - begin); ++offset) {
+                sync_dirty_bits[offset / 32] |= (1u << (offset % 32));
+            }
+            is_sync_data_staged = true;
+        }
+        else {
+            copy_to_region(region, begin - region->address, &buffer[begin - ram_address], end - begin);
+        }
+    }
+    
+    // Call write callbacks after write all regions (e.g. SCR command should be queued with new SCR argument)
+    bool result = true;
+    for (uint32_t i = first_region; i < RAM_MAP_REGION_COUNT && ram_map[i].address < end_address; ++i) {
+        
+        const ram_region_t* region = &ram_map[i];
+        if ((region->access & RAM_ACCESS_W) && region->write_callback != NULL) {
+            result = region->write_callback() && result;
+        }
+    }
+    
+    return result;
+}
 
-        if (ram_map.data[ram_address + i] != NULL) {
-            *(ram_map.data[ram_address + i]) = buffer[i];
+//  ***************************************************************************
+/// @brief  Read several RAM ranges to external buffer
+/// @note   Range list format: [address high][address low][bytes count] for each range
+/// @param  range_list: range list
+/// @param  range_count: range count
+/// @param  buffer: pointer to buffer. Data of ranges are placed one after another
+/// @param  buffer_size: buffer size
+/// @param  bytes_count: total bytes count of all ranges
+/// @retval bytes_count
+/// @return true - read data success, false - error
+//  ***************************************************************************
+bool ram_map_read_multiple(const uint8_t* range_list, uint32_t range_count, uint8_t* buffer, uint32_t buffer_size, uint32_t* bytes_count) {
+    
+    *bytes_count = 0;
+    for (uint32_t i = 0; i < range_count; ++i, range_list += RAM_MAP_RANGE_DESCRIPTOR_SIZE) {
+        
+        uint32_t address = (range_list[0] << 8) | range_list[1];
+        uint32_t range_size = range_list[2];
+        if (range_size == 0 || *bytes_count + range_size > buffer_size) {
+            return false;
         }
+        
+        if (ram_map_read(address, &buffer[*bytes_count], range_size) == false) {
+            return false;
+        }
+        *bytes_count += range_size;
     }
     
     return true;
 }
+
+//  ***************************************************************************
+/// @brief  RAM map process
+/// @note   Call from main loop before limbs driver process
+/// @param  none
+/// @return none
+//  ***************************************************************************
+void ram_map_process(void) {
+    
+    static uint32_t prev_synchro_value = 0xFFFFFFFF;
+    
+    if (synchro == prev_synchro_value) {
+        return;
+    }
+    prev_synchro_value = synchro;
+    
+    // Apply staged data at synchro boundary
+    if (is_sync_data_staged == false) {
+        return;
+    }
+    uint32_t shadow_offset = 0;
+    for (uint32_t i = 0; i < RAM_MAP_REGION_COUNT; ++i) {
+        
+        const ram_region_t* region = &ram_map[i];
+        if ((region->access & RAM_ACCESS_SYNC) == 0) continue;
+        
+        for (uint32_t offset = 0; offset < region->size && shadow_offset < SYNC_SHADOW_SIZE; ++offset, ++shadow_offset) {
+            
+            if (sync_dirty_bits[shadow_offset / 32] & (1u << (shadow_offset % 32))) {
+                copy_to_region(region, offset, &sync_shadow[shadow_offset], 1);
+            }
+        }
+    }
+    memset(sync_dirty_bits, 0, sizeof(sync_dirty_bits));
+    is_sync_data_staged = false;
+}
+
+
+
+
+//  ***************************************************************************
+/// @brief  Find first region which ends after RAM address (binary search)
+/// @param  ram_address: RAM address
+/// @return region index (RAM_MAP_REGION_COUNT if region not found)
+//  ***************************************************************************
+static uint32_t find_first_region(uint32_t ram_address) {
+    
+    uint32_t left = 0;
+    uint32_t right = RAM_MAP_REGION_COUNT;
+    while (left < right) {
+        
+        uint32_t middle = (left + right) / 2;
+        if (ram_map[middle].address + ram_map[middle].size <= ram_address) {
+            left = middle + 1;
+        } 
+        else {
+            right = middle;
+        }
+    }
+    return left;
+}
+
+//  ***************************************************************************
+/// @brief  Get offset of SYNC region data in shadow buffer
+/// @param  region_index: SYNC region index
+/// @return offset in shadow buffer
+//  ***************************************************************************
+static uint32_t get_sync_shadow_offset(uint32_t region_index) {
+    
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < region_index; ++i) {
+        if (ram_map[i].access & RAM_ACCESS_SYNC) {
+            offset += ram_map[i].size;
+        }
+    }
+    return offset;
+}
+
+//  ***************************************************************************
+/// @brief  Copy data from region to buffer with byte order converting
+/// @param  region: region
+/// @param  offset: offset from region begin
+/// @param  buffer: destination buffer
+/// @param  bytes_count: bytes count for copy
+/// @return none
+//  ***************************************************************************
+static void copy_from_region(const ram_region_t* region, uint32_t offset, uint8_t* buffer, uint32_t bytes_count) {
+    
+    if (region->word_size == 1) {
+        memcpy(buffer, &region->data[offset], bytes_count);
+        return;
+    }
+    
+    // Big-endian: high byte of word placed to low address
+    for (uint32_t i = 0; i < bytes_count; ++i, ++offset) {
+        uint32_t word_offset = offset - (offset % region->word_size);
+        buffer[i] = region->data[word_offset + (region->word_size - 1 - (offset % region->word_size))];
+    }
+}
+
+//  ***************************************************************************
+/// @brief  Copy data from buffer to region with byte order converting
+/// @param  region: region
+/// @param  offset: offset from region begin
+/// @param  buffer: source buffer
+/// @param  bytes_count: bytes count for copy
+/// @return none
+//  ***************************************************************************
+static void copy_to_region(const ram_region_t* region, uint32_t offset, const uint8_t* buffer, uint32_t bytes_count) {
+    
+    if (region->word_size == 1) {
+        memcpy(&region->data[offset], buffer, bytes_count);
+        return;
+    }
+    
+    // Big-endian: high byte of word placed to low address
+    for (uint32_t i = 0; i < bytes_count; ++i, ++offset) {
+        uint32_t word_offset = offset - (offset % region->word_size);
+        region->data[word_offset + (region->word_size - 1 - (offset % region->word_size))] = buffer[i];
+    }
+}
@@ -7,125 +7,87 @@
 #include <sam.h>
 #include "movement_engine.h"
 #include "veeprom.h"
+#include "configuration.h"
 #include "orientation.h"
+#include "systimer.h"
 
-#define SCR_CMD_SELECT_SEQUENCE_UP                      (0x01)
-#define SCR_CMD_SELECT_SEQUENCE_DOWN                    (0x02)
-#define SCR_CMD_SELECT_SEQUENCE_RUN                     (0x03)
-#define SCR_CMD_SELECT_SEQUENCE_DIRECT_MOVEMENT         (0x04)
-#define SCR_CMD_SELECT_SEQUENCE_REVERSE_MOVEMENT        (0x05)
-#define SCR_CMD_SELECT_SEQUENCE_ROTATE_LEFT             (0x06)
-#define SCR_CMD_SELECT_SEQUENCE_ROTATE_RIGHT            (0x07)
-#define SCR_CMD_SELECT_SEQUENCE_DIRECT_MOVEMENT_SLOW    (0x08)
-#define SCR_CMD_SELECT_SEQUENCE_REVERSE_MOVEMENT_SLOW   (0x09)
-#define SCR_CMD_SELECT_SEQUENCE_SHIFT_LEFT              (0x10)
-#define SCR_CMD_SELECT_SEQUENCE_SHIFT_RIGHT             (0x11)
-
-#define SCR_CMD_SELECT_SEQUENCE_ATTACK_LEFT             (0x20)
-#define SCR_CMD_SELECT_SEQUENCE_ATTACK_RIGHT            (0x21)
-#define SCR_CMD_SELECT_SEQUENCE_DANCE                   (0x30)
-#define SCR_CMD_SELECT_SEQUENCE_ROTATE_X                (0x31)
-//#define SCR_CMD_SELECT_SEQUENCE_ROTATE_Y                (0x32)
-#define SCR_CMD_SELECT_SEQUENCE_ROTATE_Z                (0x33)
-
-#define SCR_CMD_SELECT_SEQUENCE_NONE                    (0x90)
-
+// Sequence select commands are described in sequence registry (gait_sequences.h)
 #define SCR_CMD_CALCULATE_CHECKSUM                      (0xB0)
 #define SCR_CMD_ENABLE_FRONT_SENSOR                     (0xB1)
 #define SCR_CMD_DISABLE_FRONT_SENSOR                    (0xB2)
+#define SCR_CMD_COMMIT_EEPROM                           (0xB3)
 #define SCR_CMD_RESET                                   (0xFE)
 
+#define SCR_QUEUE_SIZE                                  (8)     // Should be power of 2
+#define VEEPROM_FLUSH_TIMEOUT                           (1500)  // Command is completed after this time if flush is not complete, ms
+
+
+typedef struct {
+    uint8_t id;
+    uint8_t cmd;
+    int32_t argument;
+} scr_command_t;
+
 
 uint8_t scr = 0;
 int32_t scr_argument = 0;
+uint8_t scr_last_queued_id = 0;
+uint8_t scr_last_completed_id = 0;
+
+static scr_command_t queue[SCR_QUEUE_SIZE] = {0};
+static volatile uint32_t queue_head = 0;    // Write position (changed by producer only)
+static volatile uint32_t queue_tail = 0;    // Read position (changed by consumer only)
 
+static bool is_flush_started = false;       // Command at queue tail waits VEEPROM flush
+static uint32_t flush_start_time = 0;
+
+
+static bool flush_veeprom(void);
+
+
+//  ***************************************************************************
+/// @brief  Push command from SCR and SCR argument registers to command queue
+/// @note   Call after write to SCR register
+/// @param  none
+/// @return true - command queued, false - queue is full
+//  ***************************************************************************
+bool scr_push_command(void) {
+    
+    if (queue_head - queue_tail >= SCR_QUEUE_SIZE) {
+        return false;
+    }
+    
+    // Make command ID. ID 0x00 is reserved for "no command"
+    ++scr_last_queued_id;
+    if (scr_last_queued_id == 0x00) {
+        scr_last_queued_id = 0x01;
+    }
+    
+    scr_command_t* command = &queue[queue_head & (SCR_QUEUE_SIZE - 1)];
+    command->id       = scr_last_queued_id;
+    command->cmd      = scr;
+    command->argument = scr_argument;
+    ++queue_head;
+    
+    scr = 0x00;
+    return true;
+}
 
 //  ***************************************************************************
-/// @brief    Special command register process
-/// @return    none
+/// @brief  Special command register process
+/// @note   Execute one queued command per call. VEEPROM commands stay in
+///         queue until veeprom_process() stores changes to flash
+/// @return none
 //  ***************************************************************************
 void scr_process(void) {
     
-    switch (scr) {
-        
-        case SCR_CMD_SELECT_SEQUENCE_UP:
-            movement_engine_select_sequence(SEQUENCE_UP);
-            break;
-            
-        case SCR_CMD_SELECT_SEQUENCE_DOWN:
-            movement_engine_select_sequence(SEQUENCE_DOWN);
-            break;
-            
-        case SCR_CMD_SELECT_SEQUENCE_RUN:
-            movement_engine_select_sequence(SEQUENCE_RUN);
-            break;
-            
-        case SCR_CMD_SELECT_SEQUENCE_DIRECT_MOVEMENT:
-            movement_engine_select_sequence(SEQUENCE_DIRECT_MOVEMENT);
-            break;
-            
-        case SCR_CMD_SELECT_SEQUENCE_REVERSE_MOVEMENT:
-            movement_engine_select_sequence(SEQUENCE_REVERSE_MOVEMENT);
-            break;
-        
-        case SCR_CMD_SELECT_SEQUENCE_ROTATE_LEFT:
-            movement_engine_select_sequence(SEQUENCE_ROTATE_LEFT);
-            break;
-            
-        case SCR_CMD_SELECT_SEQUENCE_ROTATE_RIGHT:
-            movement_engine_select_sequence(SEQUENCE_ROTATE_RIGHT);
-            break;
-            
-        case SCR_CMD_SELECT_SEQUENCE_DIRECT_MOVEMENT_SLOW:
-            movement_engine_select_sequence(SEQUENCE_DIRECT_MOVEMENT_SLOW);
-            break;
+    if (queue_head == queue_tail) {
+        return; // Queue is empty
+    }
+    
+    const scr_command_t* command = &queue[queue_tail & (SCR_QUEUE_SIZE - 1)];
+    switch (command->cmd) {
         
-        case SCR_CMD_SELECT_SEQUENCE_REVERSE_MOVEMENT_SLOW:
-            movement_engine_select_sequence(SEQUENCE_REVERSE_MOVEMENT_SLOW);
-            break;
-            
-        case SCR_CMD_SELECT_SEQUENCE_SHIFT_LEFT:
-            movement_engine_select_sequence(SEQUENCE_SHIFT_LEFT);
-            break;
-       
-        case SCR_CMD_SELECT_SEQUENCE_SHIFT_RIGHT:
-            movement_engine_select_sequence(SEQUENCE_SHIFT_RIGHT);
-            break;
-            
-            
-            
-        case SCR_CMD_SELECT_SEQUENCE_ATTACK_LEFT:
-            movement_engine_select_sequence(SEQUENCE_ATTACK_LEFT);
-            break;
-            
-        case SCR_CMD_SELECT_SEQUENCE_ATTACK_RIGHT:
-            movement_engine_select_sequence(SEQUENCE_ATTACK_RIGHT);
-            break;
-            
-        case SCR_CMD_SELECT_SEQUENCE_DANCE:
-            movement_engine_select_sequence(SEQUENCE_DANCE);
-            break;
-            
-        case SCR_CMD_SELECT_SEQUENCE_ROTATE_X:
-            movement_engine_select_sequence(SEQUENCE_ROTATE_X);
-            break;
-            
-        /*case SCR_CMD_SELECT_SEQUENCE_ROTATE_Y:
-            movement_engine_select_sequence(SEQUENCE_ROTATE_Y);
-            break;*/
-            
-        case SCR_CMD_SELECT_SEQUENCE_ROTATE_Z:
-            movement_engine_select_sequence(SEQUENCE_ROTATE_Z);
-            break;
-            
-            
-
-        case SCR_CMD_SELECT_SEQUENCE_NONE:
-            movement_engine_select_sequence(SEQUENCE_NONE);
-            break;
-            
-            
-            
         case SCR_CMD_ENABLE_FRONT_SENSOR:
             orientation_set_front_distance_sensor_state(true);
             break;
@@ -134,14 +96,60 @@ void scr_process(void) {
             orientation_set_front_distance_sensor_state(false);
             break;
         
-        /*case SCR_CMD_CALCULATE_CHECKSUM:
-            veeprom_update_checksum();
-            break;*/
+        case SCR_CMD_CALCULATE_CHECKSUM:
+            if (is_flush_started == false) {
+                configuration_update_header();
+                veeprom_update_checksum();
+            }
+            if (flush_veeprom() == false) {
+                return;
+            }
+            break;
+            
+        case SCR_CMD_COMMIT_EEPROM:
+            if (flush_veeprom() == false) {
+                return;
+            }
+            break;
             
         case SCR_CMD_RESET:
+            if (flush_veeprom() == false) {
+                return;
+            }
             REG_RSTC_CR = 0xA5000005;
             break;
+            
+        default:
+            movement_engine_select_sequence_by_scr_cmd(command->cmd);
+            break;
     }
     
-    scr = 0x00;
+    scr_last_completed_id = command->id;
+    ++queue_tail;
+}
+
+
+
+
+
+//  ***************************************************************************
+/// @brief  Start VEEPROM flush and check it is complete
+/// @note   Flush is started on first call for command
+/// @param  none
+/// @return true - changes are stored to flash or timeout, false - flush in progress
+//  ***************************************************************************
+static bool flush_veeprom(void) {
+    
+    if (is_flush_started == false) {
+        veeprom_flush();
+        is_flush_started = true;
+        flush_start_time = get_time_ms();
+    }
+    
+    if ((veeprom_is_dirty() == true || veeprom_is_busy() == true) && get_time_ms() - flush_start_time < VEEPROM_FLUSH_TIMEOUT) {
+        return false;
+    }
+    
+    is_flush_started = false;
+    return true;
 }
\ No newline at end of file
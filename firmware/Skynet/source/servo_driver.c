@@ -7,7 +7,7 @@
 #include <sam.h>
 #include <stdbool.h>
 #include "pwm.h"
-#include "veeprom.h"
+#include "configuration.h"
 #include "veeprom_map.h"
 #include "error_handling.h"
 
@@ -16,7 +16,7 @@
 #define SERVO_BIDIRECTIONAL_MODE_DISABLE        (0x00)
 #define SERVO_BIDIRECTIONAL_MODE_ENABLE         (0x02)
 
-#define CALIBRATION_TABLE_MAX_SIZE              (28)
+#define CALIBRATION_TABLE_MAX_SIZE              (CONFIGURATION_CALIBRATION_TABLE_SIZE)
 #define CALIBRATION_TABLE_STEP_SIZE             (10)
 
 
@@ -141,23 +141,16 @@ static bool read_configuration(void) {
     
     for (uint32_t servo_index = 0; servo_index < SUPPORT_SERVO_COUNT; ++servo_index) {
         
-        uint32_t base_address = SERVO_CONFIGURATION_BASE_EE_ADDRESS + servo_index * SERVO_CONFIGURATION_SIZE;
-        
-        // Read servo configuration
-        uint8_t config = veeprom_read_8(base_address + SERVO_CONFIG_OFFSET);
-        if (config == 0xFF) {
-            return false;
-        }
-        
-        // Read angle correction
-        uint32_t angle_correction = veeprom_read_8(base_address + SERVO_ANGLE_CORRECTION_OFFSET);
-        if (angle_correction == 0xFF) {
+        const servo_configuration_t* servo_config = configuration_get_servo(servo_index);
+        if (servo_config == NULL) {
             return false;
         }
         
-        // Read max physic angle
-        uint32_t max_physic_angle = veeprom_read_16(base_address + SERVO_MAX_PHYSIC_ANGLE_OFFSET);
-        if (max_physic_angle == 0xFFFF || angle_correction > max_physic_angle) {
+        // Check servo configuration, angle correction and max physic angle
+        uint8_t config = servo_config->config;
+        uint32_t angle_correction = servo_config->angle_correction;
+        uint32_t max_physic_angle = servo_config->max_physic_angle;
+        if (config == 0xFF || angle_correction == 0xFF || max_physic_angle == 0xFFFF || angle_correction > max_physic_angle) {
             return false;
         }
         
@@ -169,9 +162,12 @@ static bool read_configuration(void) {
 
         // Read calibration table
         uint32_t max_table_point = max_physic_angle / CALIBRATION_TABLE_STEP_SIZE;
+        if (max_table_point >= CALIBRATION_TABLE_MAX_SIZE) {
+            return false;
+        }
         for (uint32_t i = 0; i <= max_table_point; ++i) {
             
-            servo_channels[servo_index].calibration_table[i] = veeprom_read_16(base_address + SERVO_CALIBRATION_TABLE_OFFSET + i * 2);
+            servo_channels[servo_index].calibration_table[i] = servo_config->calibration_table[i];
             
             if (servo_channels[servo_index].calibration_table[i] == 0xFFFF) {
                 return false;
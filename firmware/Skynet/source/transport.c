@@ -0,0 +1,334 @@
+//  ***************************************************************************
+/// @file    transport.c
+/// @author  NeoProg
+//  ***************************************************************************
+#include "transport.h"
+
+#include <sam.h>
+#include <stddef.h>
+#include "modbus.h"
+#include "wireless_modbus.h"
+#include "crc16.h"
+#include "usart0_pdc.h"
+#include "usart3_pdc.h"
+
+#define PROTOCOL_MODBUS_RTU                     (0x01)
+#define PROTOCOL_WIRELESS_MODBUS                (0x02)
+#define SUPPORT_PROTOCOL_COUNT                  (2)
+
+
+typedef struct {
+    
+    bool(*is_frame_detected)(const uint8_t* frame, uint32_t frame_size, uint16_t crc);
+    transport_priority_t(*get_frame_priority)(const uint8_t* frame, uint32_t frame_size);
+    transport_result_t(*process_frame)(uint32_t port, const uint8_t* frame, uint32_t frame_size);
+    
+} protocol_info_t;
+
+typedef struct {
+    
+    void(*usart_init)(uint32_t baud_rate);
+    void(*usart_set_baud_rate)(uint32_t baud_rate);
+    void(*usart_reset)(bool is_reset_transmitter, bool is_reset_receiver);
+    bool(*usart_is_error)(void);
+    void(*usart_start_tx)(uint32_t bytes_count);
+    bool(*usart_is_tx_complete)(void);
+    bool(*usart_is_tx_buffer_free)(void);
+    uint8_t*(*usart_get_internal_tx_buffer_address)(void);
+    void(*usart_start_rx)(void);
+    bool(*usart_is_frame_received)(void);
+    uint32_t(*usart_get_frame_size)(void);
+    const uint8_t*(*usart_get_internal_rx_buffer_address)(void);
+    void(*usart_release_frame)(void);
+    
+    // Optional functions. NULL - not supported by driver
+    void(*usart_update_rx_crc)(void);
+    uint16_t(*usart_get_frame_crc)(void);
+    uint8_t*(*usart_get_internal_rx_buffer_address_for_tx)(void);
+    void(*usart_start_tx_from_rx_buffer)(uint32_t bytes_count);
+    
+    uint32_t protocols;                         // Accepted protocols
+    bool is_baud_rate_switch_allowed;
+    
+} usart_info_t;
+
+typedef struct {
+    
+    const uint8_t* frame;
+    uint32_t frame_size;
+    uint32_t protocol;                          // Protocol index. SUPPORT_PROTOCOL_COUNT - no frame
+    transport_priority_t priority;
+    
+} pending_frame_t;
+
+
+// Protocols are checked in this order
+static const protocol_info_t protocols[SUPPORT_PROTOCOL_COUNT] = {
+    {
+        .is_frame_detected = modbus_is_frame_detected,
+        .get_frame_priority = modbus_get_frame_priority,
+        .process_frame = modbus_process_frame
+    },
+    {
+        .is_frame_detected = wireless_modbus_is_frame_detected,
+        .get_frame_priority = wireless_modbus_get_frame_priority,
+        .process_frame = wireless_modbus_process_frame
+    }
+};
+
+static const usart_info_t usarts[TRANSPORT_PORT_COUNT] = {
+    
+    [TRANSPORT_PORT_USART0] = {
+        .usart_init = usart0_init,
+        .usart_set_baud_rate = usart0_set_baud_rate,
+        .usart_reset = usart0_reset,
+        .usart_is_error = usart0_is_error,
+        .usart_start_tx = usart0_start_tx,
+        .usart_is_tx_complete = usart0_is_tx_complete,
+        .usart_is_tx_buffer_free = usart0_is_tx_buffer_free,
+        .usart_get_internal_tx_buffer_address = usart0_get_internal_tx_buffer_address,
+        .usart_start_rx = usart0_start_rx,
+        .usart_is_frame_received = usart0_is_frame_received,
+        .usart_get_frame_size = usart0_get_frame_size,
+        .usart_get_internal_rx_buffer_address = usart0_get_internal_rx_buffer_address,
+        .usart_release_frame = usart0_release_frame,
+        .usart_update_rx_crc = NULL,
+        .usart_get_frame_crc = NULL,
+        .usart_get_internal_rx_buffer_address_for_tx = NULL,
+        .usart_start_tx_from_rx_buffer = NULL,
+        .protocols = PROTOCOL_MODBUS_RTU,
+        .is_baud_rate_switch_allowed = true
+    },
+    [TRANSPORT_PORT_USART3] = {
+        .usart_init = usart3_init,
+        .usart_set_baud_rate = usart3_set_baud_rate,
+        .usart_reset = usart3_reset,
+        .usart_is_error = usart3_is_error,
+        .usart_start_tx = usart3_start_tx,
+        .usart_is_tx_complete = usart3_is_tx_complete,
+        .usart_is_tx_buffer_free = usart3_is_tx_buffer_free,
+        .usart_get_internal_tx_buffer_address = usart3_get_internal_tx_buffer_address,
+        .usart_start_rx = usart3_start_rx,
+        .usart_is_frame_received = usart3_is_frame_received,
+        .usart_get_frame_size = usart3_get_frame_size,
+        .usart_get_internal_rx_buffer_address = usart3_get_internal_rx_buffer_address,
+        .usart_release_frame = usart3_release_frame,
+        .usart_update_rx_crc = usart3_update_rx_crc,
+        .usart_get_frame_crc = usart3_get_frame_crc,
+        .usart_get_internal_rx_buffer_address_for_tx = usart3_get_internal_rx_buffer_address_for_tx,
+        .usart_start_tx_from_rx_buffer = usart3_start_tx_from_rx_buffer,
+        .protocols = PROTOCOL_MODBUS_RTU | PROTOCOL_WIRELESS_MODBUS,
+        .is_baud_rate_switch_allowed = false    // Baud rate of wireless module is fixed
+    }
+};
+
+
+static void     collect_frame(uint32_t port, pending_frame_t* pending_frame);
+static uint16_t get_frame_crc(const usart_info_t* usart, const uint8_t* frame, uint32_t frame_size);
+
+
+//  ***************************************************************************
+/// @brief  Transport initialization
+/// @param  none
+/// @return none
+//  ***************************************************************************
+void transport_init(void) {
+    
+    for (uint32_t i = 0; i < TRANSPORT_PORT_COUNT; ++i) {
+        usarts[i].usart_init(TRANSPORT_DEFAULT_BAUD_RATE);
+        usarts[i].usart_start_rx();
+    }
+}
+
+//  ***************************************************************************
+/// @brief  Transport process
+/// @note   Call from main loop. Received frames of all ports are processed by
+///         priority. Only one bulk frame is processed per call, other bulk
+///         frames stay in RX buffers until next call
+//  ***************************************************************************
+void transport_process(void) {
+    
+    pending_frame_t pending_frames[TRANSPORT_PORT_COUNT];
+    for (uint32_t i = 0; i < TRANSPORT_PORT_COUNT; ++i) {
+        collect_frame(i, &pending_frames[i]);
+    }
+    
+    bool is_bulk_frame_processed = false;
+    for (uint32_t priority = 0; priority < TRANSPORT_PRIORITY_COUNT; ++priority) {
+        for (uint32_t i = 0; i < TRANSPORT_PORT_COUNT; ++i) {
+            
+            pending_frame_t* pending_frame = &pending_frames[i];
+            if (pending_frame->protocol == SUPPORT_PROTOCOL_COUNT || pending_frame->priority != priority) {
+                continue;
+            }
+            if (priority == TRANSPORT_PRIORITY_BULK) {
+                if (is_bulk_frame_processed == true) {
+                    continue;
+                }
+                is_bulk_frame_processed = true;
+            }
+            
+            const protocol_info_t* protocol = &protocols[pending_frame->protocol];
+            if (protocol->process_frame(i, pending_frame->frame, pending_frame->frame_size) == TRANSPORT_FRAME_PROCESSED) {
+                usarts[i].usart_release_frame();
+            }
+        }
+    }
+}
+
+//  ***************************************************************************
+/// @brief  Check frame received
+/// @param  port: port index
+/// @return true - frame received, false - no
+//  ***************************************************************************
+bool transport_is_frame_received(uint32_t port) {
+    return usarts[port].usart_is_frame_received();
+}
+
+//  ***************************************************************************
+/// @brief  Check TX buffer is free for next frame
+/// @param  port: port index
+/// @return true - buffer free, false - no
+//  ***************************************************************************
+bool transport_is_tx_buffer_free(uint32_t port) {
+    return usarts[port].usart_is_tx_buffer_free();
+}
+
+//  ***************************************************************************
+/// @brief  Check transmit complete
+/// @param  port: port index
+/// @return true - all frames transmitted, false - transmit in progress
+//  ***************************************************************************
+bool transport_is_tx_complete(uint32_t port) {
+    return usarts[port].usart_is_tx_complete();
+}
+
+//  ***************************************************************************
+/// @brief  Get TX buffer for next frame
+/// @param  port: port index
+/// @return Buffer address
+//  ***************************************************************************
+uint8_t* transport_get_tx_buffer(uint32_t port) {
+    return usarts[port].usart_get_internal_tx_buffer_address();
+}
+
+//  ***************************************************************************
+/// @brief  Start transmit frame from TX buffer
+/// @param  port: port index
+/// @param  bytes_count: frame size
+//  ***************************************************************************
+void transport_start_tx(uint32_t port, uint32_t bytes_count) {
+    usarts[port].usart_start_tx(bytes_count);
+}
+
+//  ***************************************************************************
+/// @brief  Get RX buffer of processing frame for build response in place
+/// @param  port: port index
+/// @return Buffer address, NULL - not supported by port
+//  ***************************************************************************
+uint8_t* transport_get_rx_buffer_for_tx(uint32_t port) {
+    
+    if (usarts[port].usart_get_internal_rx_buffer_address_for_tx == NULL) {
+        return NULL;
+    }
+    return usarts[port].usart_get_internal_rx_buffer_address_for_tx();
+}
+
+//  ***************************************************************************
+/// @brief  Start transmit frame from RX buffer of processing frame
+/// @note   Buffer is returned to receiver after transmit complete
+/// @param  port: port index
+/// @param  bytes_count: frame size
+//  ***************************************************************************
+void transport_start_tx_from_rx_buffer(uint32_t port, uint32_t bytes_count) {
+    
+    if (usarts[port].usart_start_tx_from_rx_buffer != NULL) {
+        usarts[port].usart_start_tx_from_rx_buffer(bytes_count);
+    }
+}
+
+//  ***************************************************************************
+/// @brief  Check port baud rate can be changed
+/// @param  port: port index
+/// @return true - allowed, false - baud rate is fixed
+//  ***************************************************************************
+bool transport_is_baud_rate_switch_allowed(uint32_t port) {
+    return usarts[port].is_baud_rate_switch_allowed;
+}
+
+//  ***************************************************************************
+/// @brief  Set port baud rate
+/// @note   Receiver is restarted. All unprocessed frames are dropped
+/// @param  port: port index
+/// @param  baud_rate: baud rate
+//  ***************************************************************************
+void transport_set_baud_rate(uint32_t port, uint32_t baud_rate) {
+    
+    usarts[port].usart_set_baud_rate(baud_rate);
+    usarts[port].usart_start_rx();
+}
+
+
+
+
+
+//  ***************************************************************************
+/// @brief  Get received frame of port and detect its protocol
+/// @note   Unknown frames are dropped
+/// @param  port: port index
+/// @param  pending_frame: pointer to frame info
+/// @retval pending_frame
+//  ***************************************************************************
+static void collect_frame(uint32_t port, pending_frame_t* pending_frame) {
+    
+    const usart_info_t* usart = &usarts[port];
+    pending_frame->protocol = SUPPORT_PROTOCOL_COUNT;
+    
+    // Check USART errors
+    if (usart->usart_is_error() == true) {
+        usart->usart_reset(true, true);
+        usart->usart_start_rx();
+        return;
+    }
+    
+    // Check frame received. Calculate CRC of receiving frame in background if driver supports it
+    if (usart->usart_is_frame_received() == false) {
+        if (usart->usart_update_rx_crc != NULL) {
+            usart->usart_update_rx_crc();
+        }
+        return;
+    }
+    
+    const uint8_t* frame = usart->usart_get_internal_rx_buffer_address();
+    uint32_t frame_size = usart->usart_get_frame_size();
+    uint16_t crc = get_frame_crc(usart, frame, frame_size);
+    
+    // Detect protocol
+    for (uint32_t p = 0; p < SUPPORT_PROTOCOL_COUNT; ++p) {
+        
+        if ((usart->protocols & (1 << p)) && protocols[p].is_frame_detected(frame, frame_size, crc) == true) {
+            pending_frame->frame = frame;
+            pending_frame->frame_size = frame_size;
+            pending_frame->protocol = p;
+            pending_frame->priority = protocols[p].get_frame_priority(frame, frame_size);
+            return;
+        }
+    }
+    usart->usart_release_frame();
+}
+
+//  ***************************************************************************
+/// @brief  Get CRC16 of received frame
+/// @note   CRC calculated by driver during frame receiving is used if supported
+/// @param  usart: USART info
+/// @param  frame: received frame
+/// @param  frame_size: received frame size
+/// @return CRC16 value
+//  ***************************************************************************
+static uint16_t get_frame_crc(const usart_info_t* usart, const uint8_t* frame, uint32_t frame_size) {
+    
+    if (usart->usart_get_frame_crc != NULL) {
+        return usart->usart_get_frame_crc();
+    }
+    return crc16_calculate(frame, frame_size);
+}
@@ -1,62 +1,259 @@
 //  ***************************************************************************
 /// @file    veeprom.c
 /// @author  NeoProg
+/// @note    VEEPROM data is stored in base pages and in log of changes. Log
+///          records are appended to erased log pages without erase. Log is
+///          merged to base pages by compaction when it is full. Base header
+///          page holds log generation: records of other generation are not
+///          replayed
 //  ***************************************************************************
 #include "veeprom.h"
 
 #include <sam.h>
+#include <string.h>
 #include "flash.h"
+#include "crc16.h"
+#include "crc32.h"
+#include "systimer.h"
 #include "error_handling.h"
 
 #define VEEPROM_BEGIN_ADDRESS           (0x0000)
-#define VEEPROM_PAGE_SIZE               (FLASH_PAGE_SIZE)
-#define VEEPROM_PAGE_COUNT              (10)
-#define VEEPROM_SIZE                    (VEEPROM_PAGE_SIZE * VEEPROM_PAGE_COUNT)    // bytes
-#define VEEPROM_END_ADDRESS             (VEEPROM_BEGIN_ADDRESS + VEEPROM_SIZE + 1)
+#define VEEPROM_END_ADDRESS             (VEEPROM_BEGIN_ADDRESS + VEEPROM_SIZE)
 
-#define VEEPROM_CHECKSUM_SIZE           (4)
-#define VEEPROM_CHECKSUM_ADDRESS        (VEEPROM_END_ADDRESS - VEEPROM_CHECKSUM_SIZE - 1)
-#define VEEPROM_DATA_END_ADDRESS        (VEEPROM_END_ADDRESS - VEEPROM_CHECKSUM_SIZE - 1)        
+// Page CRC table: [magic][CRC32 of page 0]...[CRC32 of page N]. Table is not included to page CRC
+#define CRC_TABLE_MAGIC                 (0x43524354)    // "CRCT". Table without magic is not written yet - pages are not checked
+#define CRC_TABLE_SIZE                  (4 + VEEPROM_PAGE_COUNT * 4)
+#define CRC_TABLE_ADDRESS               (VEEPROM_END_ADDRESS - CRC_TABLE_SIZE)
 
 #define VEEPROM_FLASH_START_ADDRESS     (FLASH_BANK1_START_ADDRESS + (FLASH_BANK1_PAGE_COUNT - VEEPROM_PAGE_COUNT) * FLASH_PAGE_SIZE)
+#define BASE_HEADER_FLASH_ADDRESS       (VEEPROM_FLASH_START_ADDRESS - FLASH_PAGE_SIZE)
+#define BASE_HEADER_MAGIC               (0x42415345)    // "BASE"
 
+#define LOG_PAGE_COUNT                  (32)
+#define LOG_SIZE                        (LOG_PAGE_COUNT * FLASH_PAGE_SIZE)
+#define LOG_FLASH_START_ADDRESS         (BASE_HEADER_FLASH_ADDRESS - LOG_SIZE)
+#define LOG_RECORD_MAGIC                (0x5A)
+#define LOG_BLOCK_SIZE                  (16)        // VEEPROM is logged by blocks
+#define LOG_BLOCK_COUNT                 (VEEPROM_SIZE / LOG_BLOCK_SIZE)
+#define LOG_RECORD_SIZE                 (sizeof(log_record_header_t) + LOG_BLOCK_SIZE)
+#define LOG_COMPACTION_THRESHOLD        (LOG_SIZE * 3 / 4)
 
-static uint32_t calculate_checksum(void);
+#define COMMIT_IDLE_TIME                (500)       // Time without writes before dirty blocks commit, ms
+
+
+// Base header: written by compaction after base pages update
+typedef struct __attribute__((packed)) {
+    
+    uint32_t magic;
+    uint16_t generation;                            // Generation of log records which are not merged to base pages
+    uint16_t crc;                                   // CRC16 of header (without CRC field)
+    
+} base_header_t;
+
+// Log record: header, data[length]. Records do not cross log page boundary
+typedef struct __attribute__((packed)) {
+    
+    uint8_t  magic;
+    uint8_t  length;
+    uint16_t address;
+    uint16_t generation;                            // Log generation from base header
+    uint16_t sequence;                              // Records of log have consecutive sequence numbers from 0
+    uint16_t crc;                                   // CRC16 of header (without CRC field) and data
+    
+} log_record_header_t;
+
+typedef enum {
+    COMPACTION_IDLE,
+    COMPACTION_WRITE_BASE,
+    COMPACTION_WRITE_BASE_HEADER,
+    COMPACTION_ERASE_LOG
+} compaction_state_t;
+
+
+static uint8_t  shadow[VEEPROM_SIZE] __attribute__((aligned(4))) = {0};  // VEEPROM data. Reads and writes are served from RAM
+static uint32_t dirty_blocks[(LOG_BLOCK_COUNT + 31) / 32] = {0};
+static uint32_t last_write_time = 0;
+
+static uint32_t log_offset = 0;                     // Offset for next record
+static uint16_t log_sequence = 0;                   // Sequence number for next record
+static uint16_t log_generation = 0;                 // Generation for records, stored in base header
+
+static compaction_state_t compaction_state = COMPACTION_IDLE;
+static uint32_t compaction_page = 0;
+
+static bool is_write_pending = false;               // Flash program started by veeprom_process() is not complete
+static bool is_flush_requested = false;             // Commit changes without wait COMMIT_IDLE_TIME
+
+static uint32_t page_crc[VEEPROM_PAGE_COUNT] = {0}; // Actual CRC32 of pages
+static uint32_t crc_stale_pages = 0;                // Bit per page: 1 - page changed after CRC calculation
+
+
+uint32_t veeprom_crc = 0;                           // CRC32 of page CRC list
+uint16_t veeprom_bad_pages = 0;                     // Bit per page: 1 - page CRC mismatch on boot
+
+
+static bool is_address_valid(uint32_t veeprom_address, uint32_t size);
+static void write_shadow(uint32_t veeprom_address, const uint8_t* data, uint32_t size);
+static void read_base_header(void);
+static bool replay_log(void);
+static bool is_log_full(void);
+static bool log_dirty_blocks(bool is_async);
+static void start_compaction(void);
+static bool compaction_step(bool is_async);
+static bool program_flash(uint32_t flash_address, const uint8_t* data, uint32_t size, bool is_async);
+static bool check_pending_write(void);
+static bool is_dirty_block(uint32_t block);
+static void clear_dirty_block(uint32_t block);
+static void update_page_crc(void);
+static void check_page_crc(void);
 
 
 //  ***************************************************************************
 /// @brief  Virtual EEPROM initialize
-/// @param  address: address to EEPROM memory cell
-/// @param  data: buffer address
-/// @param  size: count bytes for read
-/// @return true - initialize success, false - fail
+/// @note   Base pages are loaded to RAM shadow and log is replayed over it.
+///         Replay time is limited by log size
+/// @param  none
+/// @return none
 //  ***************************************************************************
 void veeprom_init(void) {
     
     flash_init();
+    flash_read_bytes(VEEPROM_FLASH_START_ADDRESS, shadow, VEEPROM_SIZE);
+    memset(dirty_blocks, 0x00, sizeof(dirty_blocks));
+    read_base_header();
     
-    /*uint32_t calc_checksum = calculate_checksum();
-    uint32_t read_checksum = veeprom_read_32(VEEPROM_CHECKSUM_ADDRESS);
+    // Log with corrupted record can not be continued - merge valid records to base pages
+    if (replay_log() == false) {
+        start_compaction();
+    }
     
-    if (calc_checksum != read_checksum) {
-        callback_set_memory_error(ERROR_MODULE_VEEPROM_DRIVER);
-    }*/
+    // Check data integrity. Time is fixed: CRC of VEEPROM_SIZE bytes in RAM
+    crc_stale_pages = (1 << VEEPROM_PAGE_COUNT) - 1;
+    update_page_crc();
+    check_page_crc();
 }
 
 //  ***************************************************************************
-/// @brief  Calculate and write VEEPROM checksum
-/// @note   none
-/// @return true - write success, false - fail
+/// @brief  Virtual EEPROM process
+/// @note   Call from main loop. Start one flash program per call: compaction
+///         step or log page append if no writes during COMMIT_IDLE_TIME.
+///         Program is not blocking, completion is checked on next calls
+/// @param  none
+/// @return none
 //  ***************************************************************************
-bool veeprom_update_checksum(void) {
+void veeprom_process(void) {
     
-    uint32_t checksum = calculate_checksum();
+    if (check_pending_write() == false) {
+        return;
+    }
     
-    if (flash_write_32(VEEPROM_FLASH_START_ADDRESS + VEEPROM_CHECKSUM_ADDRESS, checksum) == false) {
-        callback_set_memory_error(ERROR_MODULE_VEEPROM);
-        return false;
+    if (compaction_state != COMPACTION_IDLE) {
+        compaction_step(true);
+        return;
     }
-    return true;
+    if (is_flush_requested == false && get_time_ms() - last_write_time < COMMIT_IDLE_TIME) {
+        return;
+    }
+    
+    if (veeprom_is_dirty() == true) {
+        if (is_log_full() == true) {
+            start_compaction();
+            return;
+        }
+        log_dirty_blocks(true);
+        return;
+    }
+    is_flush_requested = false;
+    
+    // Compact log in background while VEEPROM is not used
+    if (log_offset > LOG_COMPACTION_THRESHOLD) {
+        start_compaction();
+    }
+}
+
+//  ***************************************************************************
+/// @brief  Commit all changes to flash
+/// @param  none
+/// @return true - commit success, false - fail
+//  ***************************************************************************
+bool veeprom_commit(void) {
+    
+    while (check_pending_write() == false);
+    
+    while (true) {
+        
+        if (compaction_state != COMPACTION_IDLE) {
+            if (compaction_step(false) == false) {
+                return false;
+            }
+            continue;
+        }
+        
+        if (veeprom_is_dirty() == false) {
+            return true;
+        }
+        
+        if (is_log_full() == true) {
+            start_compaction();
+            continue;
+        }
+        if (log_dirty_blocks(false) == false) {
+            return false;
+        }
+    }
+}
+
+//  ***************************************************************************
+/// @brief  Request commit of all changes by veeprom_process()
+/// @note   Changes are committed without wait COMMIT_IDLE_TIME. Commit is
+///         complete when VEEPROM is not dirty and not busy
+/// @param  none
+/// @return none
+//  ***************************************************************************
+void veeprom_flush(void) {
+    is_flush_requested = true;
+}
+
+//  ***************************************************************************
+/// @brief  Check VEEPROM has uncommitted changes
+/// @return true - has uncommitted changes, false - no
+//  ***************************************************************************
+bool veeprom_is_dirty(void) {
+    
+    for (uint32_t i = 0; i < sizeof(dirty_blocks) / sizeof(dirty_blocks[0]); ++i) {
+        if (dirty_blocks[i] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//  ***************************************************************************
+/// @brief  Check VEEPROM flash program or compaction is in progress
+/// @return true - in progress, false - no
+//  ***************************************************************************
+bool veeprom_is_busy(void) {
+    return is_write_pending == true || compaction_state != COMPACTION_IDLE;
+}
+
+//  ***************************************************************************
+/// @brief  Calculate and write VEEPROM page CRC table
+/// @note   CRC is calculated for pages changed after previous calculation.
+///         Table and changed data are committed to flash by veeprom_process()
+/// @param  none
+/// @return none
+//  ***************************************************************************
+void veeprom_update_checksum(void) {
+    
+    update_page_crc();
+    
+    veeprom_write_32(CRC_TABLE_ADDRESS, CRC_TABLE_MAGIC);
+    for (uint32_t page = 0; page < VEEPROM_PAGE_COUNT; ++page) {
+        veeprom_write_32(CRC_TABLE_ADDRESS + 4 + page * 4, page_crc[page]);
+    }
+    veeprom_bad_pages = 0;
+    
+    veeprom_flush();
 }
 
 //  ***************************************************************************
@@ -66,158 +263,515 @@ bool veeprom_update_checksum(void) {
 //  ***************************************************************************
 uint8_t veeprom_read_8(uint32_t veeprom_address) {
     
-    if (veeprom_address + sizeof(uint8_t) - 1 > VEEPROM_END_ADDRESS) {
-        callback_set_internal_error(ERROR_MODULE_VEEPROM);
+    if (is_address_valid(veeprom_address, sizeof(uint8_t)) == false) {
         return 0;
     }
     
-    return flash_read_8(VEEPROM_FLASH_START_ADDRESS + veeprom_address);
+    return shadow[veeprom_address];
 }
 
 //  ***************************************************************************
-/// @brief  Read word from flash
-/// @param  flash_address: flash address
+/// @brief  Read word from VEEPROM
+/// @param  veeprom_address: VEEPROM address
 /// @return Word value
 //  ***************************************************************************
 uint16_t veeprom_read_16(uint32_t veeprom_address) {
     
-    if (veeprom_address + sizeof(uint16_t) - 1 > VEEPROM_END_ADDRESS) {
-        callback_set_internal_error(ERROR_MODULE_VEEPROM);
+    if (is_address_valid(veeprom_address, sizeof(uint16_t)) == false) {
         return 0;
     }
     
-    return flash_read_16(VEEPROM_FLASH_START_ADDRESS + veeprom_address);
+    const uint8_t* data = &shadow[veeprom_address];
+    return (data[0] << 8) | (data[1] << 0);
 }
 
 //  ***************************************************************************
-/// @brief  Read double word from flash
-/// @param  flash_address: flash address
+/// @brief  Read double word from VEEPROM
+/// @param  veeprom_address: VEEPROM address
 /// @return Double word value
 //  ***************************************************************************
 uint32_t veeprom_read_32(uint32_t veeprom_address) {
     
-    if (veeprom_address + sizeof(uint32_t) - 1 > VEEPROM_END_ADDRESS) {
-        callback_set_internal_error(ERROR_MODULE_VEEPROM);
+    if (is_address_valid(veeprom_address, sizeof(uint32_t)) == false) {
         return 0;
     }
     
-    return flash_read_32(VEEPROM_FLASH_START_ADDRESS + veeprom_address);
+    const uint8_t* data = &shadow[veeprom_address];
+    return (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | (data[3] << 0);
 }
 
 //  ***************************************************************************
 /// @brief  Read data from virtual EEPROM
-/// @param  address: address to EEPROM memory cell
+/// @param  veeprom_address: VEEPROM address
 /// @param  buffer: buffer address
 /// @param  size: count bytes for read
 /// @return true - read success, false - fail
 //  ***************************************************************************
-void veeprom_read_bytes(uint32_t veeprom_address, uint8_t* buffer, uint32_t size) {
+bool veeprom_read_bytes(uint32_t veeprom_address, uint8_t* buffer, uint32_t size) {
 
-    if (veeprom_address + size - 1 > VEEPROM_END_ADDRESS) {
-        callback_set_internal_error(ERROR_MODULE_VEEPROM);
-        return;
+    if (is_address_valid(veeprom_address, size) == false) {
+        return false;
     }
     
-    flash_read_bytes(VEEPROM_FLASH_START_ADDRESS + veeprom_address, buffer, size);
+    memcpy(buffer, &shadow[veeprom_address], size);
+    return true;
 }
 
 //  ***************************************************************************
-/// @brief  Write byte to flash
-/// @param  flash_address: flash address
+/// @brief  Write byte to VEEPROM
+/// @param  veeprom_address: VEEPROM address
+/// @param  data: byte value
 /// @return true - write success, false - fail
 //  ***************************************************************************
 bool veeprom_write_8(uint32_t veeprom_address, uint8_t data) {
     
-    if (veeprom_address + sizeof(uint8_t) - 1 > VEEPROM_END_ADDRESS) {
-        callback_set_internal_error(ERROR_MODULE_VEEPROM);
-        return false;
-    }
+    return veeprom_write_bytes(veeprom_address, &data, sizeof(data));
+}
+
+//  ***************************************************************************
+/// @brief  Write word to VEEPROM
+/// @param  veeprom_address: VEEPROM address
+/// @param  data: word value
+/// @return true - write success, false - fail
+//  ***************************************************************************
+bool veeprom_write_16(uint32_t veeprom_address, uint16_t data) {
     
-    if (flash_write_8(VEEPROM_FLASH_START_ADDRESS + veeprom_address, data) == false) {
-        callback_set_memory_error(ERROR_MODULE_VEEPROM);
+    uint8_t bytes[2] = { (data >> 8) & 0xFF, (data >> 0) & 0xFF };
+    return veeprom_write_bytes(veeprom_address, bytes, sizeof(bytes));
+}
+
+//  ***************************************************************************
+/// @brief  Write double word to VEEPROM
+/// @param  veeprom_address: VEEPROM address
+/// @param  data: double word value
+/// @return true - write success, false - fail
+//  ***************************************************************************
+bool veeprom_write_32(uint32_t veeprom_address, uint32_t data) {
+    
+    uint8_t bytes[4] = { (data >> 24) & 0xFF, (data >> 16) & 0xFF, (data >> 8) & 0xFF, (data >> 0) & 0xFF };
+    return veeprom_write_bytes(veeprom_address, bytes, sizeof(bytes));
+}
+
+//  ***************************************************************************
+/// @brief  Write data to virtual EEPROM
+/// @note   Data is written to RAM shadow. Changed blocks are committed to flash
+///         by veeprom_commit() or after COMMIT_IDLE_TIME
+/// @param  veeprom_address: VEEPROM address
+/// @param  data: buffer address
+/// @param  size: count bytes for write
+/// @return true - write success, false - fail
+//  ***************************************************************************
+bool veeprom_write_bytes(uint32_t veeprom_address, const uint8_t* data, uint32_t size) {
+
+    if (is_address_valid(veeprom_address, size) == false) {
         return false;
     }
     
+    write_shadow(veeprom_address, data, size);
     return true;
 }
 
+
+
+
+
 //  ***************************************************************************
-/// @brief  Write word to flash
-/// @param  flash_address: flash address
-/// @return true - write success, false - fail
+/// @brief  Check VEEPROM address range
+/// @param  veeprom_address: VEEPROM address
+/// @param  size: range size
+/// @return true - range valid, false - range out of VEEPROM
 //  ***************************************************************************
-bool veeprom_write_16(uint32_t veeprom_address, uint16_t data) {
+static bool is_address_valid(uint32_t veeprom_address, uint32_t size) {
     
-    if (veeprom_address + sizeof(uint16_t) - 1 > VEEPROM_END_ADDRESS) {
+    if (size == 0 || veeprom_address >= VEEPROM_END_ADDRESS || size > VEEPROM_END_ADDRESS - veeprom_address) {
         callback_set_internal_error(ERROR_MODULE_VEEPROM);
         return false;
     }
+    return true;
+}
+
+//  ***************************************************************************
+/// @brief  Write data to RAM shadow and mark changed blocks as dirty
+/// @param  veeprom_address: VEEPROM address
+/// @param  data: buffer address
+/// @param  size: count bytes for write
+/// @return none
+//  ***************************************************************************
+static void write_shadow(uint32_t veeprom_address, const uint8_t* data, uint32_t size) {
     
-    if (flash_write_16(VEEPROM_FLASH_START_ADDRESS + veeprom_address, data) == false) {
-        callback_set_memory_error(ERROR_MODULE_VEEPROM);
-        return false;
+    for (uint32_t i = 0; i < size; ++i) {
+        
+        uint32_t address = veeprom_address + i;
+        if (shadow[address] != data[i]) {
+            
+            uint32_t block = address / LOG_BLOCK_SIZE;
+            shadow[address] = data[i];
+            dirty_blocks[block / 32] |= 1u << (block % 32);
+            if (address < CRC_TABLE_ADDRESS) {
+                crc_stale_pages |= 1 << (address / VEEPROM_PAGE_SIZE);
+            }
+        }
+    }
+    last_write_time = get_time_ms();
+}
+
+//  ***************************************************************************
+/// @brief  Read log generation from base header
+/// @note   Header is not written before first compaction - generation is 0
+/// @param  none
+/// @return none
+//  ***************************************************************************
+static void read_base_header(void) {
+    
+    base_header_t header;
+    flash_read_bytes(BASE_HEADER_FLASH_ADDRESS, (uint8_t*)&header, sizeof(header));
+    
+    uint16_t crc = crc16_calculate((const uint8_t*)&header, sizeof(header) - sizeof(header.crc));
+    if (header.magic != BASE_HEADER_MAGIC || header.crc != crc) {
+        log_generation = 0;
+        return;
     }
+    log_generation = header.generation;
+}
+
+//  ***************************************************************************
+/// @brief  Apply log records to RAM shadow
+/// @note   Replay is stopped on free space or on invalid record. Record of
+///         other generation is invalid: it is left by interrupted compaction.
+///         Write position and sequence number for next record are restored
+/// @param  none
+/// @return true - log is valid, false - log contains invalid record
+//  ***************************************************************************
+static bool replay_log(void) {
+    
+    uint8_t data[FLASH_PAGE_SIZE];
+    log_offset = 0;
+    log_sequence = 0;
     
+    while (log_offset + sizeof(log_record_header_t) <= LOG_SIZE) {
+        
+        log_record_header_t header;
+        flash_read_bytes(LOG_FLASH_START_ADDRESS + log_offset, (uint8_t*)&header, sizeof(header));
+        
+        // Free space. End of log or free space at end of page if next page contains records
+        if (header.magic == 0xFF) {
+            
+            uint32_t next_page_offset = (log_offset / FLASH_PAGE_SIZE + 1) * FLASH_PAGE_SIZE;
+            if (log_offset % FLASH_PAGE_SIZE == 0 || next_page_offset >= LOG_SIZE ||
+                flash_read_8(LOG_FLASH_START_ADDRESS + next_page_offset) == 0xFF) {
+                return true;
+            }
+            log_offset = next_page_offset;
+            continue;
+        }
+        
+        // Check record header
+        uint32_t page_space = FLASH_PAGE_SIZE - log_offset % FLASH_PAGE_SIZE;
+        if (header.magic != LOG_RECORD_MAGIC || header.length == 0 || sizeof(header) + header.length > page_space ||
+            header.address + header.length > VEEPROM_SIZE || header.generation != log_generation || header.sequence != log_sequence) {
+            return false;
+        }
+        
+        // Check record CRC
+        flash_read_bytes(LOG_FLASH_START_ADDRESS + log_offset + sizeof(header), data, header.length);
+        uint16_t crc = crc16_calculate((const uint8_t*)&header, sizeof(header) - sizeof(header.crc));
+        crc = crc16_update(crc, data, header.length);
+        if (crc != header.crc) {
+            return false;
+        }
+        
+        memcpy(&shadow[header.address], data, header.length);
+        log_offset += sizeof(header) + header.length;
+        ++log_sequence;
+    }
     return true;
 }
 
 //  ***************************************************************************
-/// @brief  Write double word to flash
-/// @param  flash_address: flash address
-/// @return true - write success, false - fail
+/// @brief  Check log has space for record
+/// @return true - log is full, false - no
 //  ***************************************************************************
-bool veeprom_write_32(uint32_t veeprom_address, uint32_t data) {
+static bool is_log_full(void) {
     
-    if (veeprom_address + sizeof(uint32_t) - 1 > VEEPROM_END_ADDRESS) {
-        callback_set_internal_error(ERROR_MODULE_VEEPROM);
-        return false;
+    uint32_t offset = log_offset;
+    if (FLASH_PAGE_SIZE - offset % FLASH_PAGE_SIZE < LOG_RECORD_SIZE) {
+        offset = (offset / FLASH_PAGE_SIZE + 1) * FLASH_PAGE_SIZE;
     }
+    return offset + LOG_RECORD_SIZE > LOG_SIZE;
+}
+
+//  ***************************************************************************
+/// @brief  Append records of dirty blocks to log
+/// @note   Records are placed to current log page only - one flash program
+///         per call without erase. Log should not be full
+/// @param  is_async: true - start flash program without wait
+/// @return true - success, false - flash program fail
+//  ***************************************************************************
+static bool log_dirty_blocks(bool is_async) {
     
-    if (flash_write_32(VEEPROM_FLASH_START_ADDRESS + veeprom_address, data) == false) {
-        callback_set_memory_error(ERROR_MODULE_VEEPROM);
+    uint8_t  batch[FLASH_PAGE_SIZE];
+    uint32_t batch_blocks[FLASH_PAGE_SIZE / LOG_RECORD_SIZE];
+    uint32_t batch_size = 0;
+    uint32_t batch_block_count = 0;
+    uint16_t sequence = log_sequence;
+    
+    // Record does not fit to current page - go to next page
+    uint32_t page_space = FLASH_PAGE_SIZE - log_offset % FLASH_PAGE_SIZE;
+    if (page_space < LOG_RECORD_SIZE) {
+        log_offset += page_space;
+        page_space = FLASH_PAGE_SIZE;
+    }
+    
+    // Make records
+    for (uint32_t block = 0; block < LOG_BLOCK_COUNT && batch_size + LOG_RECORD_SIZE <= page_space; ++block) {
+        
+        if (is_dirty_block(block) == false) {
+            continue;
+        }
+        
+        log_record_header_t* header = (log_record_header_t*)&batch[batch_size];
+        uint8_t* data = &batch[batch_size + sizeof(log_record_header_t)];
+        
+        header->magic = LOG_RECORD_MAGIC;
+        header->length = LOG_BLOCK_SIZE;
+        header->address = block * LOG_BLOCK_SIZE;
+        header->generation = log_generation;
+        header->sequence = sequence++;
+        memcpy(data, &shadow[header->address], LOG_BLOCK_SIZE);
+        
+        uint16_t crc = crc16_calculate((const uint8_t*)header, sizeof(log_record_header_t) - sizeof(header->crc));
+        header->crc = crc16_update(crc, data, LOG_BLOCK_SIZE);
+        
+        batch_blocks[batch_block_count++] = block;
+        batch_size += LOG_RECORD_SIZE;
+    }
+    if (batch_size == 0) {
+        return true;
+    }
+    
+    // Program records to erased log space
+    if (program_flash(LOG_FLASH_START_ADDRESS + log_offset, batch, batch_size, is_async) == false) {
         return false;
     }
     
+    for (uint32_t i = 0; i < batch_block_count; ++i) {
+        clear_dirty_block(batch_blocks[i]);
+    }
+    log_offset += batch_size;
+    log_sequence = sequence;
     return true;
 }
 
 //  ***************************************************************************
-/// @brief  Write data to virtual EEPROM
-/// @param  address: address to EEPROM memory cell
-/// @param  data: buffer address
-/// @param  size: count bytes for write
-/// @return true - write success, false - fail
+/// @brief  Start log compaction
+/// @param  none
+/// @return none
 //  ***************************************************************************
-bool veeprom_write_bytes(uint32_t veeprom_address, const uint8_t* data, uint32_t size) {
+static void start_compaction(void) {
+    
+    compaction_state = COMPACTION_WRITE_BASE;
+    compaction_page = 0;
+}
 
-    if (veeprom_address + size - 1 > VEEPROM_END_ADDRESS) {
-        callback_set_internal_error(ERROR_MODULE_VEEPROM);
-        return false;
+//  ***************************************************************************
+/// @brief  Execute log compaction step
+/// @note   Base pages are updated from RAM shadow, then base header with
+///         next log generation is written and log pages are erased from last
+///         page. Until header write log is complete and its replay over
+///         updated base pages gives committed data. After header write old
+///         records are rejected by generation, first log page is erased last
+///         so interrupted erase is detected on boot and compaction restarts
+/// @param  is_async: true - start flash program without wait
+/// @return true - success, false - flash program fail
+//  ***************************************************************************
+static bool compaction_step(bool is_async) {
+    
+    uint32_t page_offset = compaction_page * FLASH_PAGE_SIZE;
+    
+    switch (compaction_state) {
+        
+        case COMPACTION_WRITE_BASE:
+            if (memcmp((const uint8_t*)(VEEPROM_FLASH_START_ADDRESS + page_offset), &shadow[page_offset], FLASH_PAGE_SIZE) != 0) {
+                
+                if (program_flash(VEEPROM_FLASH_START_ADDRESS + page_offset, &shadow[page_offset], FLASH_PAGE_SIZE, is_async) == false) {
+                    return false;
+                }
+            }
+            
+            // Blocks of page are stored in base page
+            for (uint32_t i = 0; i < FLASH_PAGE_SIZE / LOG_BLOCK_SIZE; ++i) {
+                clear_dirty_block(page_offset / LOG_BLOCK_SIZE + i);
+            }
+            
+            if (++compaction_page >= VEEPROM_PAGE_COUNT) {
+                compaction_state = COMPACTION_WRITE_BASE_HEADER;
+            }
+            break;
+        
+        case COMPACTION_WRITE_BASE_HEADER:
+        {
+            uint8_t header_page[FLASH_PAGE_SIZE];
+            memset(header_page, 0xFF, sizeof(header_page));
+            
+            base_header_t* header = (base_header_t*)header_page;
+            header->magic = BASE_HEADER_MAGIC;
+            header->generation = log_generation + 1;
+            header->crc = crc16_calculate(header_page, sizeof(base_header_t) - sizeof(header->crc));
+            
+            if (program_flash(BASE_HEADER_FLASH_ADDRESS, header_page, FLASH_PAGE_SIZE, is_async) == false) {
+                return false;
+            }
+            
+            ++log_generation;
+            compaction_state = COMPACTION_ERASE_LOG;
+            compaction_page = LOG_PAGE_COUNT - 1;
+            break;
+        }
+        
+        case COMPACTION_ERASE_LOG:
+        {
+            const uint8_t* page = (const uint8_t*)(LOG_FLASH_START_ADDRESS + page_offset);
+            uint8_t erased_page[FLASH_PAGE_SIZE];
+            memset(erased_page, 0xFF, sizeof(erased_page));
+            
+            if (memcmp(page, erased_page, FLASH_PAGE_SIZE) != 0) {
+                
+                if (program_flash(LOG_FLASH_START_ADDRESS + page_offset, erased_page, FLASH_PAGE_SIZE, is_async) == false) {
+                    return false;
+                }
+            }
+            
+            if (compaction_page == 0) {
+                compaction_state = COMPACTION_IDLE;
+                log_offset = 0;
+                log_sequence = 0;
+                break;
+            }
+            --compaction_page;
+            break;
+        }
+        
+        default:
+            compaction_state = COMPACTION_IDLE;
+            break;
     }
+    return true;
+}
+
+//  ***************************************************************************
+/// @brief  Program flash
+/// @note   Asynchronous program result is checked by check_pending_write()
+/// @param  flash_address: flash address
+/// @param  data: data for program. Data is copied by flash driver
+/// @param  size: bytes count for program
+/// @param  is_async: true - start program without wait
+/// @return true - success, false - fail
+//  ***************************************************************************
+static bool program_flash(uint32_t flash_address, const uint8_t* data, uint32_t size, bool is_async) {
     
-    if (flash_write_bytes(VEEPROM_FLASH_START_ADDRESS + veeprom_address, data, size) == false) {
+    if (is_async == true) {
+        
+        if (flash_start_write_bytes(flash_address, data, size) == false) {
+            callback_set_memory_error(ERROR_MODULE_VEEPROM);
+            return false;
+        }
+        is_write_pending = true;
+        return true;
+    }
+    
+    if (flash_write_bytes(flash_address, data, size) == false) {
         callback_set_memory_error(ERROR_MODULE_VEEPROM);
         return false;
     }
-    
     return true;
 }
 
+//  ***************************************************************************
+/// @brief  Check asynchronous flash program complete
+/// @note   State is updated when program is started. On program fail base
+///         pages are rewritten from RAM shadow by compaction
+/// @param  none
+/// @return true - no program in progress, false - program in progress
+//  ***************************************************************************
+static bool check_pending_write(void) {
+    
+    if (is_write_pending == false) {
+        return true;
+    }
+    
+    flash_write_status_t status = flash_get_write_status();
+    if (status == FLASH_WRITE_IN_PROGRESS) {
+        return false;
+    }
+    
+    is_write_pending = false;
+    if (status == FLASH_WRITE_FAIL) {
+        callback_set_memory_error(ERROR_MODULE_VEEPROM);
+        start_compaction();
+    }
+    return true;
+}
 
+//  ***************************************************************************
+/// @brief  Check block is changed and not committed
+/// @param  block: block number
+/// @return true - block is dirty, false - no
+//  ***************************************************************************
+static bool is_dirty_block(uint32_t block) {
+    return (dirty_blocks[block / 32] & (1u << (block % 32))) != 0;
+}
 
+//  ***************************************************************************
+/// @brief  Mark block as committed
+/// @param  block: block number
+/// @return none
+//  ***************************************************************************
+static void clear_dirty_block(uint32_t block) {
+    dirty_blocks[block / 32] &= ~(1u << (block % 32));
+}
 
+//  ***************************************************************************
+/// @brief  Calculate CRC32 of changed pages
+/// @param  none
+/// @return none
+//  ***************************************************************************
+static void update_page_crc(void) {
+    
+    for (uint32_t page = 0; page < VEEPROM_PAGE_COUNT; ++page) {
+        
+        if ((crc_stale_pages & (1 << page)) == 0) {
+            continue;
+        }
+        
+        uint32_t begin = page * VEEPROM_PAGE_SIZE;
+        uint32_t end = (begin + VEEPROM_PAGE_SIZE < CRC_TABLE_ADDRESS) ? begin + VEEPROM_PAGE_SIZE : CRC_TABLE_ADDRESS;
+        page_crc[page] = crc32_calculate(&shadow[begin], end - begin);
+    }
+    crc_stale_pages = 0;
+    
+    veeprom_crc = crc32_calculate((const uint8_t*)page_crc, sizeof(page_crc));
+}
 
 //  ***************************************************************************
-/// @brief  Calculate VEEPROM checksum
-/// @note   none
-/// @return Checksum value
+/// @brief  Check page CRC with CRC table
+/// @note   Blank table (without magic) is not error
+/// @param  none
+/// @return none
 //  ***************************************************************************
-static uint32_t calculate_checksum(void) {
+static void check_page_crc(void) {
+    
+    veeprom_bad_pages = 0;
+    if (veeprom_read_32(CRC_TABLE_ADDRESS) != CRC_TABLE_MAGIC) {
+        return;
+    }
     
-    uint32_t checksum = 0;
-    for (uint32_t i = 0; i < VEEPROM_DATA_END_ADDRESS; i += 4) {
-        checksum += flash_read_32(VEEPROM_FLASH_START_ADDRESS + i);
+    for (uint32_t page = 0; page < VEEPROM_PAGE_COUNT; ++page) {
+        if (veeprom_read_32(CRC_TABLE_ADDRESS + 4 + page * 4) != page_crc[page]) {
+            veeprom_bad_pages |= 1 << page;
+        }
     }
     
-    return checksum;
+    if (veeprom_bad_pages != 0) {
+        callback_set_memory_error(ERROR_MODULE_VEEPROM);
+    }
 }
\ No newline at end of file
@@ -6,117 +6,110 @@
 
 #include <sam.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 #include "ram_map.h"
-#include "systimer.h"
-#include "usart3_pdc.h"
+#include "bulk_transfer.h"
+#include "crc16.h"
 #include "error_handling.h"
 
-#define USART_BAUD_RATE                         (500000)
-#define CRC16_POLYNOM							(0xA001)
+#define MAX_RANGE_COUNT							(64)
+#define BULK_WINDOW_SIZE						(3)		// Requests are queued in USART3 RX buffers ring
 
 
-static wireless_frame_t wireless_frame = {0};
-
-
-static bool is_wireless_modbus_frame_detected(const uint8_t* data, uint32_t data_size);
+static uint32_t get_request_data_size(const wireless_frame_t* frame);
+static uint32_t get_response_data_size(const wireless_frame_t* frame);
 static void read_ram_command_handler(wireless_frame_t* frame);
 static void write_ram_command_handler(wireless_frame_t* frame);
-static uint16_t calculate_crc16(const uint8_t* frame, uint32_t size);
+static void read_ram_multiple_command_handler(wireless_frame_t* frame);
+static void read_bulk_info_command_handler(wireless_frame_t* frame);
+static void read_bulk_chunk_command_handler(wireless_frame_t* frame);
 
 
 //  ***************************************************************************
-/// @brief	Wireless modbus driver initialization
-/// @return	none
+/// @brief	Process wireless frame
+/// @note	Response is built in RX buffer of request and transmitted from it
+/// @param	port: transport port index
+/// @param	frame_data: received frame
+/// @param	frame_size: received frame size
+/// @return	TRANSPORT_FRAME_WAIT - PDC can not accept response, TRANSPORT_FRAME_PROCESSED - frame processed
 //  ***************************************************************************
-void wireless_modbus_init(void) {
+transport_result_t wireless_modbus_process_frame(uint32_t port, const uint8_t* frame_data, uint32_t frame_size) {
 	
-	usart3_init(USART_BAUD_RATE);
-	usart3_start_rx(USART3_USE_INTERNAL_BUFFER, 0);
-}
-
-//  ***************************************************************************
-/// @brief	Wireless modbus driver process
-/// @note	Call from main loop
-//  ***************************************************************************
-void wireless_modbus_process(void) {
-
-	// Check USART errors
-	if (usart3_is_error() == true) {
-		usart3_reset(true, true);
-		usart3_start_rx(USART3_USE_INTERNAL_BUFFER, 0);
-		return;
-	}
-	
-	// Check frame received
-	if (usart3_is_frame_received() == false) {
-		return;
+	// Check frame can hold header
+	if (frame_size < WIRELESS_MODBUS_FRAME_HEADER_SIZE + WIRELESS_MODBUS_FRAME_CRC_SIZE) {
+		return TRANSPORT_FRAME_PROCESSED;
 	}
 	
-	// Check complete transmit response
-	if (usart3_is_tx_complete() == false) {
-		usart3_start_rx(USART3_USE_INTERNAL_BUFFER, 0);
-		return;
+	// Check PDC can accept response. Request stays in RX buffer until previous frames are transmitted
+	if (transport_is_tx_buffer_free(port) == false) {
+		return TRANSPORT_FRAME_WAIT;
 	}
 	
-
-	const uint8_t* recv_data = usart3_get_internal_rx_buffer_address();
-	uint32_t data_size = usart3_get_frame_size();
-	
-	// Verify frame
-	if (is_wireless_modbus_frame_detected(recv_data, data_size) == false) {
-		usart3_start_rx(USART3_USE_INTERNAL_BUFFER, 0);
-		return;
+	// Response is built in place of request. Port should transmit from RX buffer of this frame
+	uint8_t* response_data = transport_get_rx_buffer_for_tx(port);
+	if (response_data == NULL || response_data != frame_data) {
+		return TRANSPORT_FRAME_PROCESSED;
 	}
 
 	// Process frame
-	memcpy(&wireless_frame, recv_data, WIRELESS_MODBUS_FRAME_SIZE);
-	switch (wireless_frame.function_code) {
+	wireless_frame_t* frame = (wireless_frame_t*)response_data;
+	bool is_variable_frame = (frame->function_code & WIRELESS_MODBUS_VARIABLE_FRAME) != 0;
+	switch (frame->function_code & ~WIRELESS_MODBUS_VARIABLE_FRAME) {
 		
 		case WIRELESS_MODBUS_CMD_WRITE_RAM:
-			write_ram_command_handler(&wireless_frame);
+			write_ram_command_handler(frame);
 			break;
 		
 		case WIRELESS_MODBUS_CMD_READ_RAM:
-			read_ram_command_handler(&wireless_frame);
+			read_ram_command_handler(frame);
+			break;
+		
+		case WIRELESS_MODBUS_CMD_READ_RAM_MULTIPLE:
+			read_ram_multiple_command_handler(frame);
+			break;
+		
+		case WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA_SIZE:
+			read_bulk_info_command_handler(frame);
+			break;
+		
+		case WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA:
+			read_bulk_chunk_command_handler(frame);
 			break;
 		
 		default:
-			usart3_reset(true, true);
-			usart3_start_rx(USART3_USE_INTERNAL_BUFFER, 0);
-			return;
+			return TRANSPORT_FRAME_PROCESSED;
 	}
 
-	// Prepare response
-	wireless_frame.crc = calculate_crc16((uint8_t*)&wireless_frame, WIRELESS_MODBUS_FRAME_SIZE - WIRELESS_MODBUS_FRAME_CRC_SIZE);
+	// Prepare response. CRC is placed after data for variable size frame
+	uint32_t response_size = WIRELESS_MODBUS_FRAME_SIZE;
+	if (is_variable_frame == true) {
+		response_size = WIRELESS_MODBUS_FRAME_HEADER_SIZE + get_response_data_size(frame) + WIRELESS_MODBUS_FRAME_CRC_SIZE;
+	}
+	uint16_t crc = crc16_calculate(response_data, response_size - WIRELESS_MODBUS_FRAME_CRC_SIZE);
+	response_data[response_size - 2] = (crc >> 0) & 0xFF;
+	response_data[response_size - 1] = (crc >> 8) & 0xFF;
 	
-	// Start transmit response
-	uint8_t* tx_buffer = usart3_get_internal_tx_buffer_address();
-	memcpy(tx_buffer, &wireless_frame, WIRELESS_MODBUS_FRAME_SIZE);
-	memset(&wireless_frame, 0x00, WIRELESS_MODBUS_FRAME_SIZE);
-	usart3_start_tx(WIRELESS_MODBUS_FRAME_SIZE);
-
-	// Start receive next frame
-	usart3_start_rx(USART3_USE_INTERNAL_BUFFER, 0);
+	// Start transmit response from request buffer. Buffer is returned to receiver after transmit complete
+	transport_start_tx_from_rx_buffer(port, response_size);
+	return TRANSPORT_FRAME_PROCESSED;
 }
 
-
-
-
-
 //  ***************************************************************************
 /// @brief	Check received data
+/// @param	raw_frame: received data
+/// @param	frame_size: received data size
+/// @param	crc: CRC16 of received data
 /// @return	true - wireless frame detected, false - any data
 //  ***************************************************************************
-static bool is_wireless_modbus_frame_detected(const uint8_t* raw_frame, uint32_t frame_size) {
+bool wireless_modbus_is_frame_detected(const uint8_t* raw_frame, uint32_t frame_size, uint16_t crc) {
 	
 	// Check frame size
-	if (frame_size != WIRELESS_MODBUS_FRAME_SIZE) {
+	if (frame_size < WIRELESS_MODBUS_FRAME_HEADER_SIZE + WIRELESS_MODBUS_FRAME_CRC_SIZE || frame_size > WIRELESS_MODBUS_FRAME_SIZE) {
 		return false;
 	}
 	
-	// Check CRC
-	uint32_t crc = calculate_crc16(raw_frame, frame_size);
+	// Check CRC. CRC is calculated during frame receiving
 	if (crc != 0) {
 		return false;
 	}
@@ -125,13 +118,91 @@ static bool is_wireless_modbus_frame_detected(const uint8_t* raw_frame, uint32_t
     const wireless_frame_t* wireless_frame = (const wireless_frame_t*)raw_frame;
 	if (wireless_frame->function_code != WIRELESS_MODBUS_CMD_WRITE_RAM &&
 		wireless_frame->function_code != WIRELESS_MODBUS_CMD_READ_RAM &&
+		wireless_frame->function_code != WIRELESS_MODBUS_CMD_READ_RAM_MULTIPLE &&
 		wireless_frame->function_code != WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA_SIZE &&
-		wireless_frame->function_code != WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA) {
+		wireless_frame->function_code != WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA &&
+		wireless_frame->function_code != WIRELESS_MODBUS_CMD_WRITE_RAM_VARIABLE &&
+		wireless_frame->function_code != WIRELESS_MODBUS_CMD_READ_RAM_VARIABLE &&
+		wireless_frame->function_code != WIRELESS_MODBUS_CMD_READ_RAM_MULTIPLE_VARIABLE &&
+		wireless_frame->function_code != WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA_SIZE_VARIABLE &&
+		wireless_frame->function_code != WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA_VARIABLE) {
 			
 		return false;
 	}
+	
+	// Check frame size for frame type
+	uint32_t expected_frame_size = WIRELESS_MODBUS_FRAME_SIZE;
+	if (wireless_frame->function_code & WIRELESS_MODBUS_VARIABLE_FRAME) {
+		expected_frame_size = WIRELESS_MODBUS_FRAME_HEADER_SIZE + get_request_data_size(wireless_frame) + WIRELESS_MODBUS_FRAME_CRC_SIZE;
+	}
+	return frame_size == expected_frame_size;
+}
 
-	return true;
+//  ***************************************************************************
+/// @brief	Get wireless frame priority
+/// @param	raw_frame: received data
+/// @param	frame_size: received data size
+/// @return	frame priority
+//  ***************************************************************************
+transport_priority_t wireless_modbus_get_frame_priority(const uint8_t* raw_frame, uint32_t frame_size) {
+	
+	// Check frame can hold header with function code
+	if (frame_size < WIRELESS_MODBUS_FRAME_HEADER_SIZE) {
+		return TRANSPORT_PRIORITY_READ;
+	}
+	
+	const wireless_frame_t* wireless_frame = (const wireless_frame_t*)raw_frame;
+	switch (wireless_frame->function_code & ~WIRELESS_MODBUS_VARIABLE_FRAME) {
+		
+		case WIRELESS_MODBUS_CMD_WRITE_RAM:
+			return TRANSPORT_PRIORITY_CONTROL;
+		
+		case WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA_SIZE:
+		case WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA:
+			return TRANSPORT_PRIORITY_BULK;
+		
+		default:
+			return TRANSPORT_PRIORITY_READ;
+	}
+}
+
+
+
+
+
+//  ***************************************************************************
+/// @brief	Get data size of variable size request frame
+/// @param	frame: pointer to wireless frame
+/// @return	data size
+//  ***************************************************************************
+static uint32_t get_request_data_size(const wireless_frame_t* frame) {
+	
+	switch (frame->function_code & ~WIRELESS_MODBUS_VARIABLE_FRAME) {
+		case WIRELESS_MODBUS_CMD_WRITE_RAM:			return frame->bytes_count;
+		case WIRELESS_MODBUS_CMD_READ_RAM_MULTIPLE:	return frame->bytes_count * RAM_MAP_RANGE_DESCRIPTOR_SIZE;
+		case WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA:	return WIRELESS_MODBUS_BULK_OFFSET_SIZE;
+		default:									return 0;
+	}
+}
+
+//  ***************************************************************************
+/// @brief	Get data size of variable size response frame
+/// @param	frame: pointer to processed wireless frame
+/// @return	data size
+//  ***************************************************************************
+static uint32_t get_response_data_size(const wireless_frame_t* frame) {
+	
+	if (frame->function_code & WIRELESS_MODBUS_EXCEPTION) {
+		return 0;
+	}
+	
+	switch (frame->function_code & ~WIRELESS_MODBUS_VARIABLE_FRAME) {
+		case WIRELESS_MODBUS_CMD_READ_RAM:			return frame->bytes_count;
+		case WIRELESS_MODBUS_CMD_READ_RAM_MULTIPLE:	return frame->bytes_count;
+		case WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA_SIZE:	return WIRELESS_MODBUS_BULK_INFO_SIZE;
+		case WIRELESS_MODBUS_CMD_READ_MULTIMEDIA_DATA:	return WIRELESS_MODBUS_BULK_OFFSET_SIZE + frame->bytes_count + WIRELESS_MODBUS_BULK_CHUNK_CRC_SIZE;
+		default:									return 0;
+	}
 }
 
 //  ***************************************************************************
@@ -156,6 +227,7 @@ static void read_ram_command_handler(wireless_frame_t* frame) {
 
 //  ***************************************************************************
 /// @brief  Function for processing ModBus write RAM command
+/// @note   Response contains request data
 /// @param  frame: pointer to wireless frame
 /// @retval frame
 //  ***************************************************************************
@@ -172,34 +244,95 @@ static void write_ram_command_handler(wireless_frame_t* frame) {
 		frame->function_code |= WIRELESS_MODBUS_EXCEPTION;
 		return;
 	}
-	
-	// Clear written data
-	memset(frame->data, 0x00, WIRELESS_MODBUS_FRAME_SIZE);
 }
 
 
+//  ***************************************************************************
+/// @brief  Function for processing ModBus read several RAM ranges command
+/// @note   Request: bytes_count - range count, data - range list
+/// @note   Response: bytes_count - total bytes count, data - data of all ranges
+/// @param  frame: pointer to wireless frame
+/// @retval frame
+//  ***************************************************************************
+static void read_ram_multiple_command_handler(wireless_frame_t* frame) {
+	
+	// Check request parameters
+	if (frame->bytes_count == 0 || frame->bytes_count > MAX_RANGE_COUNT) {
+		frame->function_code |= WIRELESS_MODBUS_EXCEPTION;
+		return;
+	}
+	
+	// Range list and response data placed in same buffer - copy range list
+	uint8_t range_list[MAX_RANGE_COUNT * RAM_MAP_RANGE_DESCRIPTOR_SIZE];
+	memcpy(range_list, frame->data, frame->bytes_count * RAM_MAP_RANGE_DESCRIPTOR_SIZE);
+	
+	// Process command
+	uint32_t bytes_count = 0;
+	if (ram_map_read_multiple(range_list, frame->bytes_count, frame->data, WIRELESS_MODBUS_FRAME_DATA_SIZE, &bytes_count) == false) {
+		frame->function_code |= WIRELESS_MODBUS_EXCEPTION;
+		return;
+	}
+	frame->bytes_count = bytes_count;
+}
+
+//  ***************************************************************************
+/// @brief  Function for processing read bulk transfer blob info command
+/// @note   Request: address - blob ID
+/// @note   Response: data - blob size, max chunk size, window size
+/// @param  frame: pointer to wireless frame
+/// @retval frame
+//  ***************************************************************************
+static void read_bulk_info_command_handler(wireless_frame_t* frame) {
+	
+	uint32_t blob_size = 0;
+	if (bulk_transfer_get_blob_size(frame->address, &blob_size) == false) {
+		frame->function_code |= WIRELESS_MODBUS_EXCEPTION;
+		return;
+	}
+	
+	uint16_t max_chunk_size = WIRELESS_MODBUS_BULK_MAX_CHUNK_SIZE;
+	memcpy(&frame->data[0], &blob_size, sizeof(blob_size));
+	memcpy(&frame->data[4], &max_chunk_size, sizeof(max_chunk_size));
+	frame->data[6] = BULK_WINDOW_SIZE;
+	frame->bytes_count = WIRELESS_MODBUS_BULK_INFO_SIZE;
+}
 
 //  ***************************************************************************
-/// @brief  Calculate frame CRC16
-/// @param  wireless_frame: pointer to wireless frame
-/// @return CRC16 value
+/// @brief  Function for processing read bulk transfer blob chunk command
+/// @note   Request: address - blob ID, bytes_count - chunk size, data - offset
+/// @note   Response: bytes_count - actual chunk size, data - offset, chunk, chunk CRC16.
+///         Chunk size is limited by blob end
+/// @param  frame: pointer to wireless frame
+/// @retval frame
 //  ***************************************************************************
-static uint16_t calculate_crc16(const uint8_t* frame, uint32_t size) {
+static void read_bulk_chunk_command_handler(wireless_frame_t* frame) {
 	
-	uint16_t crc16 = 0xFFFF;
-	uint16_t data = 0;
-	uint16_t k = 0;
+	uint32_t offset = 0;
+	uint32_t blob_size = 0;
+	memcpy(&offset, &frame->data[0], sizeof(offset));
 	
-	while (size--) {
-		crc16 ^= *frame++;
-		k = 8;
-		while (k--) {
-			data = crc16;
-			crc16 >>= 1;
-			if (data & 0x0001) {
-				crc16 ^= CRC16_POLYNOM;
-			}
-		}
+	// Check request parameters
+	if (bulk_transfer_get_blob_size(frame->address, &blob_size) == false || offset >= blob_size ||
+		frame->bytes_count == 0 || frame->bytes_count > WIRELESS_MODBUS_BULK_MAX_CHUNK_SIZE) {
+		frame->function_code |= WIRELESS_MODBUS_EXCEPTION;
+		return;
+	}
+	
+	// Last chunk of blob can be less than requested
+	uint32_t chunk_size = frame->bytes_count;
+	if (chunk_size > blob_size - offset) {
+		chunk_size = blob_size - offset;
+	}
+	
+	// Process command
+	uint8_t* chunk = &frame->data[WIRELESS_MODBUS_BULK_OFFSET_SIZE];
+	if (bulk_transfer_read(frame->address, offset, chunk, chunk_size) == false) {
+		frame->function_code |= WIRELESS_MODBUS_EXCEPTION;
+		return;
 	}
-	return crc16;
-}
\ No newline at end of file
+	
+	uint16_t chunk_crc = crc16_calculate(chunk, chunk_size);
+	chunk[chunk_size + 0] = (chunk_crc >> 0) & 0xFF;
+	chunk[chunk_size + 1] = (chunk_crc >> 8) & 0xFF;
+	frame->bytes_count = chunk_size;
+}
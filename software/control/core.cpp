@@ -3,8 +3,11 @@
 #include <QDebug>
 #include <QEventLoop>
 
+#define TELEMETRY_PERIOD					(200)	// ms
+#define STATUS_BLOCK_SIZE					(12)	// Main block and SCR status
 
-Core::Core(QObject *parent) : QObject(parent) {
+
+Core::Core(QObject *parent) : QObject(parent), m_scrQueuedId(-1), m_isSCRWriteInProgress(false) {
 
 	m_statusUpdateTimer.setInterval(1000);
 	connect(&m_statusUpdateTimer, &QTimer::timeout, this, &Core::statusUpdateTimer);
@@ -17,6 +20,9 @@ Core::Core(QObject *parent) : QObject(parent) {
 	connect(this, &Core::disconnectFromServerSignal, m_wirelessModbus, &WirelessModbus::disconnectFromServer);
 	connect(this, &Core::writeDataToRamSignal, m_wirelessModbus, &WirelessModbus::writeRAM);
 	connect(this, &Core::readDataFromRamSignal, m_wirelessModbus, &WirelessModbus::readRAM);
+	connect(this, &Core::readMultipleDataFromRamSignal, m_wirelessModbus, &WirelessModbus::readRAMMultiple);
+	connect(this, &Core::subscribeTelemetrySignal, m_wirelessModbus, &WirelessModbus::subscribeTelemetry);
+	connect(m_wirelessModbus, &WirelessModbus::telemetryReceivedSignal, this, &Core::telemetryReceived);
 }
 
 Core::~Core() {
@@ -35,13 +41,22 @@ bool Core::connectToServer() {
 		return false;
 	}
 
-	m_statusUpdateTimer.start();
+	// Last queued SCR command ID is used for detect lost write responses
+	uint8_t queuedId = 0;
+	uint8_t completedId = 0;
+	m_scrQueuedId = (readSCRStatus(&queuedId, &completedId) == true) ? queuedId : -1;
+
+	// Status is pushed by device. Poll status if telemetry is not supported
+	if (subscribeTelemetry(true) == false) {
+		m_statusUpdateTimer.start();
+	}
 	return true;
 }
 
 void Core::disconnectFromServer() {
 
 	m_statusUpdateTimer.stop();
+	subscribeTelemetry(false);
 
 	emit disconnectFromServerSignal();
 	this->waitOperationCompleted();
@@ -79,17 +94,89 @@ bool Core::writeToSCR(int cmd, int retryCount) {
 	QByteArray data;
 	data.push_back(static_cast<char>(cmd));
 
-	for (int i = 0; i < retryCount; ++i) {
+	// Status update can be called while wait operation. It should not change last queued ID
+	m_isSCRWriteInProgress = true;
+	bool isQueued = false;
+
+	for (int i = 0; i < retryCount && isQueued == false; ++i) {
 
 		emit writeDataToRamSignal(SCR_REGISTER_ADDRESS, data);
 		this->waitOperationCompleted();
 
-		if (m_wirelessModbus->operationResult()) {
-			return true;
+		// Successful write response means command is queued (full queue is reported by exception)
+		if (m_wirelessModbus->operationResult() == true) {
+			if (m_scrQueuedId >= 0) {
+				m_scrQueuedId = nextSCRCommandId(static_cast<uint8_t>(m_scrQueuedId));
+			}
+			isQueued = true;
+			continue;
+		}
+
+		// Response can be lost. Send command again only if it not queued
+		uint8_t queuedId = 0;
+		uint8_t completedId = 0;
+		if (readSCRStatus(&queuedId, &completedId) == false) {
+			m_scrQueuedId = -1;
+			continue;
 		}
+		isQueued = (m_scrQueuedId >= 0 && queuedId == nextSCRCommandId(static_cast<uint8_t>(m_scrQueuedId)));
+		m_scrQueuedId = queuedId;
+	}
+
+	m_isSCRWriteInProgress = false;
+	return isQueued;
+}
+
+uint8_t Core::nextSCRCommandId(uint8_t id) {
+
+	// Command ID 0x00 is not used by firmware
+	++id;
+	return (id == 0x00) ? 0x01 : id;
+}
+
+bool Core::readSCRStatus(uint8_t* queuedId, uint8_t* completedId) {
+
+	QByteArray buffer;
+	emit readDataFromRamSignal(SCR_STATUS_ADDRESS, &buffer, 2);
+	this->waitOperationCompleted();
+
+	if (m_wirelessModbus->operationResult() == false || buffer.size() != 2) {
+		return false;
 	}
 
-	return false;
+	*queuedId = static_cast<uint8_t>(buffer[0]);
+	*completedId = static_cast<uint8_t>(buffer[1]);
+	return true;
+}
+
+bool Core::subscribeTelemetry(bool isEnable) {
+
+	RamRangeList rangeList;
+	if (isEnable == true) {
+		rangeList.push_back(qMakePair<uint16_t, uint8_t>(MAIN_BLOCK_ADDRESS, 10));
+		rangeList.push_back(qMakePair<uint16_t, uint8_t>(SCR_STATUS_ADDRESS, 2));
+	}
+
+	emit subscribeTelemetrySignal(rangeList, TELEMETRY_PERIOD);
+	this->waitOperationCompleted();
+	return m_wirelessModbus->operationResult();
+}
+
+void Core::processStatusBlock(const QByteArray& buffer) {
+
+	if (buffer.size() != STATUS_BLOCK_SIZE) {
+		return;
+	}
+
+	// Make error status
+	uint16_t errorStatus = static_cast<uint16_t>((buffer[1] << 8) | (buffer[0] << 0));
+	emit systemStatusUpdatedSignal(errorStatus);
+	emit systemVoltageUpdatedSignal(buffer[2], buffer[3], buffer[4]);
+
+	// Commands can be queued by other clients
+	if (m_isSCRWriteInProgress == false) {
+		m_scrQueuedId = static_cast<uint8_t>(buffer[10]);
+	}
 }
 
 void Core::waitOperationCompleted() {
@@ -107,18 +194,22 @@ void Core::waitOperationCompleted() {
 //
 void Core::statusUpdateTimer() {
 
+	// Read main block and SCR status by one request
+	RamRangeList rangeList;
+	rangeList.push_back(qMakePair<uint16_t, uint8_t>(MAIN_BLOCK_ADDRESS, 10));
+	rangeList.push_back(qMakePair<uint16_t, uint8_t>(SCR_STATUS_ADDRESS, 2));
+
 	QByteArray buffer;
-	emit readDataFromRamSignal(MAIN_BLOCK_ADDRESS, &buffer, 10);
+	emit readMultipleDataFromRamSignal(rangeList, &buffer);
 	waitOperationCompleted();
 
 	if (m_wirelessModbus->operationResult() == false) {
 		return;
 	}
+	processStatusBlock(buffer);
+}
 
-	// Make error status
-	if (buffer.size() == 10) {
-		uint16_t errorStatus = static_cast<uint16_t>((buffer[1] << 8) | (buffer[0] << 0));
-		emit systemStatusUpdatedSignal(errorStatus);
-		emit systemVoltageUpdatedSignal(buffer[2], buffer[3], buffer[4]);
-	}
+void Core::telemetryReceived(QByteArray data) {
+
+	processStatusBlock(data);
 }
@@ -45,12 +45,19 @@ signals:
 	void disconnectFromServerSignal();
 	void writeDataToRamSignal(int address, QByteArray data);
 	void readDataFromRamSignal(int address, QByteArray* data, int bytesCount);
+	void readMultipleDataFromRamSignal(RamRangeList rangeList, QByteArray* data);
+	void subscribeTelemetrySignal(RamRangeList rangeList, int period);
 
 public slots:
 	void statusUpdateTimer();
+	void telemetryReceived(QByteArray data);
 
 protected:
 	bool writeToSCR(int cmd, int retryCount);
+	static uint8_t nextSCRCommandId(uint8_t id);
+	bool readSCRStatus(uint8_t* queuedId, uint8_t* completedId);
+	bool subscribeTelemetry(bool isEnable);
+	void processStatusBlock(const QByteArray& buffer);
 	void waitOperationCompleted();
 
 protected:
@@ -58,6 +65,8 @@ protected:
 	WirelessModbus* m_wirelessModbus;
 	QTimer m_statusUpdateTimer;
 	QFuture<bool> m_concurrentFuture;
+	int m_scrQueuedId;
+	bool m_isSCRWriteInProgress;
 };
 
 #endif // CORE_H
@@ -2,24 +2,29 @@
 #include <QHostAddress>
 #include <QDebug>
 #include "wirelessmodbus.h"
+#include "crc16.h"
 #define SERVER_IP_ADDRESS					("111.111.111.111")
 #define SERVER_PORT							(3333)
 
-#define CRC16_POLYNOM						(0xA001)
-
 #define MODBUS_CMD_WRITE_RAM				(0x41)	// Function Code: Write RAM
 #define MODBUS_CMD_WRITE_EEPROM				(0x43)	// Function Code: Write EEPROM
 #define MODBUS_CMD_READ_RAM					(0x44)	// Function Code: Read RAM
 #define MODBUS_CMD_READ_EEPROM				(0x46)	// Function Code: Read EEPROM
+#define MODBUS_CMD_READ_RAM_MULTIPLE		(0x47)	// Function Code: Read several RAM ranges
+#define MODBUS_CMD_TELEMETRY				(0x48)	// Function Code: Telemetry frame (sent by device without request)
 #define MODBUS_EXCEPTION					(0x80)	// Function Code: Exception
 
+#define MODBUS_DEVICE_ADDRESS				(0xFE)
 #define MODBUS_MIN_RESPONSE_LENGTH			(4)
+#define MODBUS_MAX_WRITE_RAM_SIZE			(32)
 
 
 
 WirelessModbus::WirelessModbus(QObject* parent) : QObject(parent) {
 
 	m_socket = nullptr;
+	m_isResponseReceived = false;
+	qRegisterMetaType<RamRangeList>();
 }
 
 bool WirelessModbus::isOperationInProgress() const {
@@ -66,6 +71,7 @@ void WirelessModbus::disconnectFromServer(void) {
 	this->initialize();
 	m_socket->abort();
 	m_socket->disconnectFromHost();
+	m_rxBuffer.clear();
 
 	qDebug() << "WirelessModbus: [disconnectFromServer] Stop";
 	m_operationResult = true;
@@ -126,15 +132,40 @@ void WirelessModbus::writeRAM(uint16_t address, QByteArray data) {
 			break;
 		}
 
+		// Send request and receive response
+		m_operationResult = writeRAMRequest(address, data);
+	}
+	while (0);
+
+	qDebug() << "WirelessModbus: [writeRAM] Stop";
+	m_operationInProgress = false;
+}
+
+void WirelessModbus::readRAMMultiple(RamRangeList rangeList, QByteArray* buffer) {
+
+	qDebug() << "WirelessModbus: [readRAMMultiple] Start";
+	m_operationInProgress = true;
+
+	this->initialize();
+
+	do
+	{
+		// Check socket state
+		if (m_socket->state() != QTcpSocket::SocketState::ConnectedState) {
+			qDebug() << "WirelessModbus: [readRAMMultiple] Wrong socket state";
+			m_operationResult = false;
+			break;
+		}
+
 		// Make request
 		QByteArray request;
 		request.push_back(static_cast<char>(0xFE));
-		request.push_back(static_cast<char>(MODBUS_CMD_WRITE_RAM));
-		request.push_back(static_cast<char>((address & 0xFF00) >> 8));
-		request.push_back(static_cast<char>((address & 0x00FF) >> 0));
-		request.push_back(static_cast<char>(data.size()));
-		for (int i = 0; i < data.size(); ++i) {
-			request.push_back(static_cast<char>(data[i]));
+		request.push_back(static_cast<char>(MODBUS_CMD_READ_RAM_MULTIPLE));
+		request.push_back(static_cast<char>(rangeList.size()));
+		for (int i = 0; i < rangeList.size(); ++i) {
+			request.push_back(static_cast<char>((rangeList[i].first & 0xFF00) >> 8));
+			request.push_back(static_cast<char>((rangeList[i].first & 0x00FF) >> 0));
+			request.push_back(static_cast<char>(rangeList[i].second));
 		}
 
 		uint16_t crc = calculateCRC16(request);
@@ -142,11 +173,12 @@ void WirelessModbus::writeRAM(uint16_t address, QByteArray data) {
 		request.push_back(static_cast<char>((crc & 0xFF00) >> 8));
 
 		// Send request and receive response
-		m_operationResult = processModbusTransaction(request, nullptr);
+		buffer->clear();
+		m_operationResult = processModbusTransaction(request, buffer);
 	}
-	while (0);
+	while (false);
 
-	qDebug() << "WirelessModbus: [writeRAM] Stop";
+	qDebug() << "WirelessModbus: [readRAMMultiple] Stop";
 	m_operationInProgress = false;
 }
 
@@ -228,6 +260,51 @@ void WirelessModbus::writeEEPROM(uint16_t address, const QByteArray& data) {
 	m_operationInProgress = false;
 }
 
+void WirelessModbus::subscribeTelemetry(RamRangeList rangeList, uint16_t period) {
+
+	qDebug() << "WirelessModbus: [subscribeTelemetry] Start";
+	m_operationInProgress = true;
+
+	this->initialize();
+
+	do
+	{
+		// Check socket state
+		if (m_socket->state() != QTcpSocket::SocketState::ConnectedState) {
+			qDebug() << "WirelessModbus: [subscribeTelemetry] Wrong socket state";
+			m_operationResult = false;
+			break;
+		}
+
+		// Write period, range count and range list. Empty range list - unsubscribe
+		QByteArray data;
+		data.push_back(static_cast<char>((period & 0xFF00) >> 8));
+		data.push_back(static_cast<char>((period & 0x00FF) >> 0));
+		data.push_back(static_cast<char>(rangeList.size()));
+		for (int i = 0; i < rangeList.size(); ++i) {
+			data.push_back(static_cast<char>((rangeList[i].first & 0xFF00) >> 8));
+			data.push_back(static_cast<char>((rangeList[i].first & 0x00FF) >> 0));
+			data.push_back(static_cast<char>(rangeList[i].second));
+		}
+
+		m_operationResult = true;
+		for (int offset = 0; offset < data.size() && rangeList.isEmpty() == false && m_operationResult == true; offset += MODBUS_MAX_WRITE_RAM_SIZE) {
+			m_operationResult = writeRAMRequest(static_cast<uint16_t>(TELEMETRY_PERIOD_ADDRESS + offset), data.mid(offset, MODBUS_MAX_WRITE_RAM_SIZE));
+		}
+		if (m_operationResult == false) {
+			break;
+		}
+
+		// Apply subscription. Device returns exception if subscription is invalid
+		char port = static_cast<char>(rangeList.isEmpty() ? TELEMETRY_PORT_DISABLED : TELEMETRY_PORT_WIRELESS);
+		m_operationResult = writeRAMRequest(TELEMETRY_PORT_ADDRESS, QByteArray(1, port));
+	}
+	while (false);
+
+	qDebug() << "WirelessModbus: [subscribeTelemetry] Stop";
+	m_operationInProgress = false;
+}
+
 
 
 
@@ -236,13 +313,38 @@ void WirelessModbus::initialize() {
 	if (m_socket == nullptr) {
 		m_socket = new QTcpSocket(this);
 		m_timeoutTimer = new QTimer;
+
+		// Telemetry frames are received without request
+		connect(m_socket, &QTcpSocket::readyRead, this, &WirelessModbus::receiveFrames);
+	}
+}
+
+bool WirelessModbus::writeRAMRequest(uint16_t address, const QByteArray& data) {
+
+	// Make request
+	QByteArray request;
+	request.push_back(static_cast<char>(MODBUS_DEVICE_ADDRESS));
+	request.push_back(static_cast<char>(MODBUS_CMD_WRITE_RAM));
+	request.push_back(static_cast<char>((address & 0xFF00) >> 8));
+	request.push_back(static_cast<char>((address & 0x00FF) >> 0));
+	request.push_back(static_cast<char>(data.size()));
+	for (int i = 0; i < data.size(); ++i) {
+		request.push_back(static_cast<char>(data[i]));
 	}
+
+	uint16_t crc = calculateCRC16(request);
+	request.push_back(static_cast<char>((crc & 0x00FF) >> 0));
+	request.push_back(static_cast<char>((crc & 0xFF00) >> 8));
+
+	// Send request and receive response
+	return processModbusTransaction(request, nullptr);
 }
 
 bool WirelessModbus::processModbusTransaction(const QByteArray& request, QByteArray* responseData) {
 
-	// Clear socket
-	m_socket->readAll();
+	// Drop responses of previous transactions
+	this->receiveFrames();
+	m_isResponseReceived = false;
 
 	// Send request
 	m_socket->write(request);
@@ -253,56 +355,93 @@ bool WirelessModbus::processModbusTransaction(const QByteArray& request, QByteAr
 	m_timeoutTimer->setInterval(100);
 	m_timeoutTimer->setSingleShot(true);
 	m_timeoutTimer->start();
-	while (m_socket->bytesAvailable() < MODBUS_MIN_RESPONSE_LENGTH) {
+	while (m_isResponseReceived == false) {
 
 		QGuiApplication::processEvents();
+		this->receiveFrames();
 
-		if (m_timeoutTimer->isActive() == false) {
+		if (m_isResponseReceived == false && m_timeoutTimer->isActive() == false) {
 			return false;
 		}
 	}
-
-	// Read response
-	QByteArray response = m_socket->readAll();
-
-	// Verify response
-	if (this->calculateCRC16(response) != 0) {
-		return false;
-	}
+	QByteArray response = m_response;
 
 	// Check function code or exception
 	if (response[1] & MODBUS_EXCEPTION) {
 		return false;
 	}
+	if (response[1] != request[1]) {
+		return false;
+	}
 
 	// Copy data from response
 	if (request[1] == MODBUS_CMD_READ_RAM || request[1] == MODBUS_CMD_READ_EEPROM) {
 		*responseData = response.mid(3, request[4]);
 	}
+	if (request[1] == MODBUS_CMD_READ_RAM_MULTIPLE) {
+		*responseData = response.mid(3, static_cast<uint8_t>(response[2]));
+	}
 
 	return true;
 }
 
-uint16_t WirelessModbus::calculateCRC16(const QByteArray& frameByteArray) {
+void WirelessModbus::receiveFrames() {
 
-	uint8_t size = static_cast<uint8_t>(frameByteArray.size());
-	const uint8_t* frame = reinterpret_cast<const uint8_t*>(frameByteArray.data());
+	m_rxBuffer.append(m_socket->readAll());
+	while (m_rxBuffer.size() >= MODBUS_MIN_RESPONSE_LENGTH) {
 
+		// Search frame begin
+		if (static_cast<uint8_t>(m_rxBuffer[0]) != MODBUS_DEVICE_ADDRESS) {
+			m_rxBuffer.remove(0, 1);
+			continue;
+		}
 
-	uint16_t crc16 = 0xFFFF;
-	uint16_t data = 0;
-	uint16_t k = 0;
+		// Wait frame end
+		int frameSize = getFrameSize(m_rxBuffer);
+		if (m_rxBuffer.size() < frameSize) {
+			break;
+		}
+
+		// Verify frame. Search next frame begin if frame is broken
+		QByteArray frame = m_rxBuffer.left(frameSize);
+		if (this->calculateCRC16(frame) != 0) {
+			m_rxBuffer.remove(0, 1);
+			continue;
+		}
+		m_rxBuffer.remove(0, frameSize);
 
-	while (size--) {
-		crc16 ^= *frame++;
-		k = 8;
-		while (k--) {
-			data = crc16;
-			crc16 >>= 1;
-			if (data & 0x0001) {
-				crc16 ^= CRC16_POLYNOM;
-			}
+		// Dispatch frame
+		if (static_cast<uint8_t>(frame[1]) == MODBUS_CMD_TELEMETRY) {
+			emit telemetryReceivedSignal(frame.mid(3, static_cast<uint8_t>(frame[2])));
 		}
+		else {
+			m_response = frame;
+			m_isResponseReceived = true;
+		}
+	}
+}
+
+int WirelessModbus::getFrameSize(const QByteArray& buffer) {
+
+	uint8_t functionCode = static_cast<uint8_t>(buffer[1]);
+	if (functionCode & MODBUS_EXCEPTION) {
+		return 5; // Address, function code, exception code, CRC
+	}
+
+	switch (functionCode) {
+	case MODBUS_CMD_READ_RAM:
+	case MODBUS_CMD_READ_EEPROM:
+	case MODBUS_CMD_READ_RAM_MULTIPLE:
+	case MODBUS_CMD_TELEMETRY:
+		return static_cast<uint8_t>(buffer[2]) + 5; // Address, function code, bytes count, data, CRC
+
+	default:
+		return 4; // Address, function code, CRC
 	}
-	return crc16;
+}
+
+uint16_t WirelessModbus::calculateCRC16(const QByteArray& frameByteArray) {
+
+	const uint8_t* frame = reinterpret_cast<const uint8_t*>(frameByteArray.data());
+	return crc16_calculate(frame, static_cast<uint32_t>(frameByteArray.size()));
 }
@@ -5,6 +5,8 @@
 #include <QTcpSocket>
 #include <QTimer>
 #include <QThread>
+#include <QVector>
+#include <QPair>
 
 #define SCR_REGISTER_ADDRESS								(0x0060)
 #define		SCR_CMD_SELECT_SEQUENCE_UP                      (0x01)
@@ -32,8 +34,19 @@
 #define		SCR_CMD_ENABLE_FRONT_SENSOR                     (0xB1)
 #define		SCR_CMD_DISABLE_FRONT_SENSOR                    (0xB2)
 
+#define		SCR_STATUS_ADDRESS                              (0x0065)	// Last queued command ID, last completed command ID
+
 #define MAIN_BLOCK_ADDRESS									(0x0010)
 
+#define TELEMETRY_PORT_ADDRESS								(0x0100)	// Write to port register applies subscription
+#define TELEMETRY_PERIOD_ADDRESS							(0x0101)	// Period, range count, range list
+#define		TELEMETRY_PORT_DISABLED                         (0x00)
+#define		TELEMETRY_PORT_WIRELESS                         (0x02)
+
+
+typedef QVector<QPair<uint16_t, uint8_t>> RamRangeList;	// Address, bytes count
+Q_DECLARE_METATYPE(RamRangeList)
+
 
 class WirelessModbus : public QObject {
 
@@ -49,12 +62,20 @@ public slots:
 	void disconnectFromServer(void);
 	void readRAM(uint16_t address, QByteArray* buffer, uint8_t bytesCount);
 	void writeRAM(uint16_t address, QByteArray data);
+	void readRAMMultiple(RamRangeList rangeList, QByteArray* buffer);
 	void readEEPROM(uint16_t address, QByteArray* buffer, uint8_t bytesCount);
 	void writeEEPROM(uint16_t address, const QByteArray& data);
+	void subscribeTelemetry(RamRangeList rangeList, uint16_t period);
+
+signals:
+	void telemetryReceivedSignal(QByteArray data);
 
 protected:
 	void initialize();
+	bool writeRAMRequest(uint16_t address, const QByteArray& data);
 	bool processModbusTransaction(const QByteArray& request, QByteArray* responseData);
+	void receiveFrames();
+	static int getFrameSize(const QByteArray& buffer);
 	uint16_t calculateCRC16(const QByteArray &frameByteArray);
 
 private:
@@ -62,6 +83,9 @@ private:
 	QTimer* m_timeoutTimer;
 	bool m_operationInProgress;
 	bool m_operationResult;
+	QByteArray m_rxBuffer;				// Received bytes which are not parsed yet
+	QByteArray m_response;
+	bool m_isResponseReceived;
 };
 
 #endif // WIRELESSMODBUS_H
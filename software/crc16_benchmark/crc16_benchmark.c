@@ -0,0 +1,106 @@
+//  ***************************************************************************
+/// @file    crc16_benchmark.c
+/// @author  NeoProg
+/// @brief   Host benchmark: bitwise vs table-driven ModBus CRC16
+/// @note    Build and run from this directory:
+///          gcc -O2 -I../../firmware/Skynet/include crc16_benchmark.c ../../firmware/Skynet/source/crc16.c -o crc16_benchmark
+///          ./crc16_benchmark
+//  ***************************************************************************
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include "crc16.h"
+
+#define CRC16_POLYNOM                           (0xA001)    // CRC polynom
+#define FRAME_SIZE                              (1024)
+#define ITERATION_COUNT                         (20000)
+
+
+static uint16_t calculate_crc16_bitwise(const uint8_t* frame, uint32_t size);
+static double get_time_us(void);
+
+
+//  ***************************************************************************
+/// @brief  Benchmark entry point
+/// @param  none
+/// @return 0 - success, 1 - CRC mismatch
+//  ***************************************************************************
+int main(void) {
+
+    static uint8_t frame[FRAME_SIZE];
+    for (uint32_t i = 0; i < FRAME_SIZE; ++i) {
+        frame[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    // Check results before measuring
+    uint16_t bitwise_crc = calculate_crc16_bitwise(frame, FRAME_SIZE);
+    uint16_t table_crc = crc16_calculate(frame, FRAME_SIZE);
+    uint16_t split_crc = crc16_update(crc16_update(CRC16_INITIAL_VALUE, frame, 100), frame + 100, FRAME_SIZE - 100);
+    if (bitwise_crc != table_crc || table_crc != split_crc) {
+        printf("CRC mismatch: bitwise 0x%04X, table 0x%04X, split 0x%04X\n", bitwise_crc, table_crc, split_crc);
+        return 1;
+    }
+
+    // Accumulate results so the compiler can not drop the loops
+    volatile uint16_t sink = 0;
+
+    double begin = get_time_us();
+    for (uint32_t i = 0; i < ITERATION_COUNT; ++i) {
+        frame[0] = (uint8_t)i;
+        sink ^= calculate_crc16_bitwise(frame, FRAME_SIZE);
+    }
+    double bitwise_time = (get_time_us() - begin) / ITERATION_COUNT;
+
+    begin = get_time_us();
+    for (uint32_t i = 0; i < ITERATION_COUNT; ++i) {
+        frame[0] = (uint8_t)i;
+        sink ^= crc16_calculate(frame, FRAME_SIZE);
+    }
+    double table_time = (get_time_us() - begin) / ITERATION_COUNT;
+
+    printf("Frame size: %u bytes, iterations: %u\n", FRAME_SIZE, ITERATION_COUNT);
+    printf("Bitwise: %.2f us per frame\n", bitwise_time);
+    printf("Table:   %.2f us per frame\n", table_time);
+    printf("Speedup: %.1fx\n", bitwise_time / table_time);
+    (void)sink;
+    return 0;
+}
+
+//  ***************************************************************************
+/// @brief  Calculate ModBus frame CRC16 (bitwise reference implementation)
+/// @param  frame: ModBus frame
+/// @param  size:  frame size
+/// @return CRC16 value
+//  ***************************************************************************
+static uint16_t calculate_crc16_bitwise(const uint8_t* frame, uint32_t size) {
+
+    uint16_t crc16 = 0xFFFF;
+    uint16_t data = 0;
+    uint16_t k = 0;
+
+    while (size--) {
+        crc16 ^= *frame++;
+        k = 8;
+        while (k--) {
+            data = crc16;
+            crc16 >>= 1;
+            if (data & 0x0001) {
+                crc16 ^= CRC16_POLYNOM;
+            }
+        }
+    }
+    return crc16;
+}
+
+//  ***************************************************************************
+/// @brief  Get monotonic time
+/// @param  none
+/// @return Time [us]
+//  ***************************************************************************
+static double get_time_us(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
@@ -13,12 +13,16 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    ../../firmware/Skynet/source/crc16.c \
     core.cpp \
     main.cpp \
     modbus.cpp
 
 RESOURCES += qml.qrc
 
+# CRC16 module shared with firmware
+INCLUDEPATH += $$PWD/../../firmware/Skynet/include
+
 RC_FILE = resource.rc
 
 # Additional import path used to resolve QML modules in Qt Creator's code model
@@ -33,6 +37,7 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    ../../firmware/Skynet/include/crc16.h \
     core.h \
     modbus.h
 
@@ -8,6 +8,12 @@
 #include <QFileDialog>
 #include <QFile>
 
+#define UPLOAD_BAUD_RATE					(1000000)
+#define DEFAULT_BAUD_RATE					(115200)
+
+#define SCR_REGISTER_ADDRESS				(0x0060)
+#define SCR_CMD_CALCULATE_CHECKSUM			(0xB0)
+
 const QString reposityroBaseUrl = "https://raw.githubusercontent.com/NeoProg2013/Skynet_configurations/master/";
 const QString versionFileName = "VERSION";
 
@@ -202,25 +208,18 @@ bool Core::loadConfigurationToDevice() {
 	}
 	emit showActionResult("OK");
 
-	// Write data to device
-	for (int i = 0; i < memoryDump.size(); i += 16) {
-
-		// Make data block
-		QByteArray dataBlock = memoryDump.mid(i, 16);
+	// Switch to high baud rate for upload. Upload continues at default baud rate if adapter does not support it
+	emit showActionMessage("Switching baud rate...");
+	bool isBaudRateSwitched = m_modbus.setBaudRate(UPLOAD_BAUD_RATE);
+	emit showActionResult(isBaudRateSwitched ? "OK" : "FAIL");
 
-		// Make address for log message
-		QString address = QString::number(i, 16).toUpper();
-		while (address.size() != 4) {
-			address.insert(0, '0');
-		}
-
-		// Send modbus request for write data
-		emit showActionMessage("Writting data to address " + address + "...");
-		if (m_modbus.writeEEPROM(static_cast<uint16_t>(i), dataBlock) == false) {
-			emit showActionResult("FAIL");
-			return false;
-		}
-		emit showActionResult("OK");
+	// Write data and return to default baud rate on any result
+	bool isDataWritten = this->writeMemoryDumpToDevice(memoryDump);
+	if (isBaudRateSwitched == true) {
+		m_modbus.setBaudRate(DEFAULT_BAUD_RATE);
+	}
+	if (isDataWritten == false) {
+		return false;
 	}
 
 	emit showOperationCompletedMessage("Operation completed");
@@ -230,6 +229,27 @@ bool Core::loadConfigurationToDevice() {
 
 
 
+bool Core::writeMemoryDumpToDevice(const QByteArray& memoryDump) {
+
+	// Write data to device by one transaction. Device writes data to flash after CRC check
+	emit showActionMessage("Writting data (" + QString::number(memoryDump.size()) + " bytes)...");
+	if (m_modbus.writeEEPROMTransaction(0x0000, memoryDump) == false) {
+		emit showActionResult("FAIL");
+		return false;
+	}
+	emit showActionResult("OK");
+
+	// Update page CRC table for check data on device boot
+	emit showActionMessage("Updating checksum...");
+	if (m_modbus.writeRAM(SCR_REGISTER_ADDRESS, QByteArray(1, static_cast<char>(SCR_CMD_CALCULATE_CHECKSUM))) == false) {
+		emit showActionResult("FAIL");
+		return false;
+	}
+	emit showActionResult("OK");
+
+	return true;
+}
+
 void Core::getMemoryDumpFromRawData(QString& rawData, QByteArray& memoryDump) {
 
 	// Remove spaces and \r \n symbols
@@ -24,6 +24,7 @@ signals:
 	void showOperationCompletedMessage(QString message);
 
 protected:
+	bool writeMemoryDumpToDevice(const QByteArray &memoryDump);
 	void getMemoryDumpFromRawData(QString &rawData, QByteArray &memoryDump);
 
 protected:
@@ -2,23 +2,30 @@
 #include <QHostAddress>
 #include <QDebug>
 #include <QSerialPortInfo>
+#include <QThread>
 #include "modbus.h"
-
-#define CRC16_POLYNOM						(0xA001)
+#include "crc16.h"
 
 #define MODBUS_CMD_WRITE_RAM				(0x41)	// Function Code: Write RAM
 #define MODBUS_CMD_WRITE_EEPROM				(0x43)	// Function Code: Write EEPROM
 #define MODBUS_CMD_READ_RAM					(0x44)	// Function Code: Read RAM
 #define MODBUS_CMD_READ_EEPROM				(0x46)	// Function Code: Read EEPROM
+#define MODBUS_CMD_SET_BAUD_RATE			(0x49)	// Function Code: Set baud rate
+#define MODBUS_CMD_BEGIN_EEPROM_TRANSACTION	(0x4A)	// Function Code: Begin EEPROM write transaction
+#define MODBUS_CMD_WRITE_EEPROM_CHUNK		(0x4B)	// Function Code: Write chunk of EEPROM write transaction
+#define MODBUS_CMD_COMMIT_EEPROM_TRANSACTION	(0x4C)	// Function Code: Check and commit EEPROM write transaction
 #define MODBUS_EXCEPTION					(0x80)	// Function Code: Exception
 
 #define MODBUS_MIN_RESPONSE_LENGTH			(4)
+#define MODBUS_DEFAULT_BAUD_RATE			(QSerialPort::BaudRate::Baud115200)
+#define MODBUS_BAUD_RATE_FALLBACK_TIMEOUT	(2000)	// Device returns to default baud rate after this time, ms
+#define MODBUS_COMMIT_TIMEOUT				(2000)	// Device programs flash before commit response, ms
 
 
 
 Modbus::Modbus(QObject* parent) : QObject(parent) {
 
-	m_port.setBaudRate(QSerialPort::BaudRate::Baud115200);
+	m_port.setBaudRate(MODBUS_DEFAULT_BAUD_RATE);
 	m_port.setParity(QSerialPort::Parity::NoParity);
 	m_port.setStopBits(QSerialPort::StopBits::TwoStop);
 	m_port.setDataBits(QSerialPort::DataBits::Data8);
@@ -29,6 +36,7 @@ bool Modbus::findDevice(void) {
 	qDebug() << "Modbus: [findDevice] Start";
 
 	// Find device
+	m_port.setBaudRate(MODBUS_DEFAULT_BAUD_RATE);
 	auto serialPortList = QSerialPortInfo::availablePorts();
 	for (int i = 0; i < serialPortList.size(); ++i) {
 
@@ -158,7 +166,112 @@ bool Modbus::writeEEPROM(uint16_t address, const QByteArray& data) {
 
 
 
-bool Modbus::processModbusTransaction(const QByteArray& request, QByteArray* responseData) {
+bool Modbus::setBaudRate(qint32 baudRate) {
+
+	qDebug() << "Modbus: [setBaudRate] Start";
+
+	// Make request
+	QByteArray request;
+	request.push_back(static_cast<char>(0xFE));
+	request.push_back(static_cast<char>(MODBUS_CMD_SET_BAUD_RATE));
+	request.push_back(static_cast<char>((baudRate >> 24) & 0xFF));
+	request.push_back(static_cast<char>((baudRate >> 16) & 0xFF));
+	request.push_back(static_cast<char>((baudRate >>  8) & 0xFF));
+	request.push_back(static_cast<char>((baudRate >>  0) & 0xFF));
+
+	uint16_t crc = calculateCRC16(request);
+	request.push_back(static_cast<char>((crc & 0x00FF) >> 0));
+	request.push_back(static_cast<char>((crc & 0xFF00) >> 8));
+
+	// Send request at current baud rate. Device switches baud rate after response
+	bool operationResult = processModbusTransaction(request, nullptr);
+	if (operationResult == true) {
+
+		// Confirm new baud rate by valid request. Otherwise device returns to default baud rate after timeout
+		QByteArray id;
+		m_port.setBaudRate(baudRate);
+		operationResult = this->readRAM(0x0000, &id, 4);
+		if (operationResult == false) {
+			m_port.setBaudRate(MODBUS_DEFAULT_BAUD_RATE);
+			QThread::msleep(MODBUS_BAUD_RATE_FALLBACK_TIMEOUT);
+		}
+	}
+
+	qDebug() << "Modbus: [setBaudRate] Stop";
+	return operationResult;
+}
+
+bool Modbus::writeEEPROMTransaction(uint16_t address, const QByteArray& data) {
+
+	qDebug() << "Modbus: [writeEEPROMTransaction] Start";
+
+	// Begin transaction. Device returns max chunk size
+	QByteArray request;
+	request.push_back(static_cast<char>(0xFE));
+	request.push_back(static_cast<char>(MODBUS_CMD_BEGIN_EEPROM_TRANSACTION));
+	request.push_back(static_cast<char>((address & 0xFF00) >> 8));
+	request.push_back(static_cast<char>((address & 0x00FF) >> 0));
+	request.push_back(static_cast<char>((data.size() & 0xFF00) >> 8));
+	request.push_back(static_cast<char>((data.size() & 0x00FF) >> 0));
+
+	uint16_t crc = calculateCRC16(request);
+	request.push_back(static_cast<char>((crc & 0x00FF) >> 0));
+	request.push_back(static_cast<char>((crc & 0xFF00) >> 8));
+
+	QByteArray responseData;
+	if (processModbusTransaction(request, &responseData) == false || responseData.size() != 1 || responseData[0] == 0) {
+		qDebug() << "Modbus: [writeEEPROMTransaction] Stop";
+		return false;
+	}
+	int maxChunkSize = static_cast<uint8_t>(responseData[0]);
+
+	// Send data to device staging buffer
+	for (int offset = 0; offset < data.size(); offset += maxChunkSize) {
+
+		QByteArray chunk = data.mid(offset, maxChunkSize);
+
+		request.clear();
+		request.push_back(static_cast<char>(0xFE));
+		request.push_back(static_cast<char>(MODBUS_CMD_WRITE_EEPROM_CHUNK));
+		request.push_back(static_cast<char>((offset & 0xFF00) >> 8));
+		request.push_back(static_cast<char>((offset & 0x00FF) >> 0));
+		request.push_back(static_cast<char>(chunk.size()));
+		request.append(chunk);
+
+		crc = calculateCRC16(request);
+		request.push_back(static_cast<char>((crc & 0x00FF) >> 0));
+		request.push_back(static_cast<char>((crc & 0xFF00) >> 8));
+
+		if (processModbusTransaction(request, nullptr) == false) {
+			qDebug() << "Modbus: [writeEEPROMTransaction] Stop";
+			return false;
+		}
+	}
+
+	// Commit transaction. Device checks data CRC and programs flash
+	uint16_t dataCrc = calculateCRC16(data);
+	request.clear();
+	request.push_back(static_cast<char>(0xFE));
+	request.push_back(static_cast<char>(MODBUS_CMD_COMMIT_EEPROM_TRANSACTION));
+	request.push_back(static_cast<char>((data.size() & 0xFF00) >> 8));
+	request.push_back(static_cast<char>((data.size() & 0x00FF) >> 0));
+	request.push_back(static_cast<char>((dataCrc & 0xFF00) >> 8));
+	request.push_back(static_cast<char>((dataCrc & 0x00FF) >> 0));
+
+	crc = calculateCRC16(request);
+	request.push_back(static_cast<char>((crc & 0x00FF) >> 0));
+	request.push_back(static_cast<char>((crc & 0xFF00) >> 8));
+
+	bool operationResult = processModbusTransaction(request, nullptr, MODBUS_COMMIT_TIMEOUT);
+
+	qDebug() << "Modbus: [writeEEPROMTransaction] Stop";
+	return operationResult;
+}
+
+
+
+
+bool Modbus::processModbusTransaction(const QByteArray& request, QByteArray* responseData, int timeout) {
 
 	// Open and clear serial port
 	if (m_port.open(QSerialPort::ReadWrite) == false) {
@@ -172,7 +285,7 @@ bool Modbus::processModbusTransaction(const QByteArray& request, QByteArray* res
 
 	// Wait response
 	m_timeoutTimer.stop();
-	m_timeoutTimer.setInterval(500);
+	m_timeoutTimer.setInterval(timeout);
 	m_timeoutTimer.setSingleShot(true);
 	m_timeoutTimer.start();
 	while (m_port.bytesAvailable() < MODBUS_MIN_RESPONSE_LENGTH) {
@@ -203,30 +316,15 @@ bool Modbus::processModbusTransaction(const QByteArray& request, QByteArray* res
 	if (request[1] == MODBUS_CMD_READ_RAM || request[1] == MODBUS_CMD_READ_EEPROM) {
 		*responseData = response.mid(3, request[4]);
 	}
+	if (request[1] == MODBUS_CMD_BEGIN_EEPROM_TRANSACTION) {
+		*responseData = response.mid(2, 1);
+	}
 
 	return true;
 }
 
 uint16_t Modbus::calculateCRC16(const QByteArray& frameByteArray) {
 
-	uint8_t size = static_cast<uint8_t>(frameByteArray.size());
 	const uint8_t* frame = reinterpret_cast<const uint8_t*>(frameByteArray.data());
-
-
-	uint16_t crc16 = 0xFFFF;
-	uint16_t data = 0;
-	uint16_t k = 0;
-
-	while (size--) {
-		crc16 ^= *frame++;
-		k = 8;
-		while (k--) {
-			data = crc16;
-			crc16 >>= 1;
-			if (data & 0x0001) {
-				crc16 ^= CRC16_POLYNOM;
-			}
-		}
-	}
-	return crc16;
+	return crc16_calculate(frame, static_cast<uint32_t>(frameByteArray.size()));
 }
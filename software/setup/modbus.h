@@ -18,9 +18,11 @@ public:
 	bool writeRAM(uint16_t address, QByteArray data);
 	bool readEEPROM(uint16_t address, QByteArray* buffer, uint8_t bytesCount);
 	bool writeEEPROM(uint16_t address, const QByteArray& data);
+	bool setBaudRate(qint32 baudRate);
+	bool writeEEPROMTransaction(uint16_t address, const QByteArray& data);
 
 protected:
-	bool processModbusTransaction(const QByteArray& request, QByteArray* responseData);
+	bool processModbusTransaction(const QByteArray& request, QByteArray* responseData, int timeout = 500);
 	uint16_t calculateCRC16(const QByteArray &frameByteArray);
 
 private: